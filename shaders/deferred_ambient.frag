@@ -0,0 +1,24 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+// Only the leading members of the global UBO are declared, the offsets match shader.frag
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    mat4 inverseView;
+    vec4 ambientLightColor;
+} ubo;
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput inputAlbedo;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput inputDepth;
+
+void main() {
+    // Nothing was drawn here, keep the clear color
+    if (subpassLoad(inputDepth).r == 1.0) {
+        discard;
+    }
+
+    vec3 albedo = subpassLoad(inputAlbedo).rgb;
+    outColor = vec4(albedo * ubo.ambientLightColor.xyz * ubo.ambientLightColor.w, 1.0);
+}
\ No newline at end of file
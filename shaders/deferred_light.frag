@@ -0,0 +1,68 @@
+#version 450
+
+layout(location = 0) in vec3 fragPosView;
+layout(location = 1) flat in uint fragLightIndex;
+
+layout(location = 0) out vec4 outColor;
+
+layout(constant_id = 1) const bool SPECULAR_ENABLED = true;
+
+// Only the leading members of the global UBO are declared, the offsets match shader.frag
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    mat4 inverseView;
+} ubo;
+
+struct PointLightData {
+    vec3 position;
+    float range;
+    vec4 color;
+    float radius;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer PointLightBuffer {
+    PointLightData lights[];
+};
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput inputAlbedo;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput inputNormal;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput inputDepth;
+
+void main() {
+    // Depth is P22 + P32 / z for view depth z, and the surface lies on the view ray through the volume
+    float depth = subpassLoad(inputDepth).r;
+    float viewDepth = ubo.projection[3][2] / (depth - ubo.projection[2][2]);
+    vec3 positionView = fragPosView * (viewDepth / fragPosView.z);
+    vec3 fragPosWorld = (ubo.inverseView * vec4(positionView, 1.0)).xyz;
+
+    vec3 albedo = subpassLoad(inputAlbedo).rgb;
+    vec3 surfaceNormal = subpassLoad(inputNormal).xyz;
+    vec3 cameraPosWorld = ubo.inverseView[3].xyz;
+    vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
+
+    // Same lighting as shader.frag, for a single light
+    PointLightData light = lights[fragLightIndex];
+    vec3 directionToLight = light.position - fragPosWorld;
+    float distanceSquared = dot(directionToLight, directionToLight);
+    float rangeSquared = light.range * light.range;
+    float falloff = 1.0 - distanceSquared * distanceSquared / (rangeSquared * rangeSquared);
+    falloff = clamp(falloff, 0.0, 1.0);
+    float attenuation = falloff * falloff / distanceSquared;
+    directionToLight = normalize(directionToLight);
+
+    float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0.0);
+    vec3 intensity = light.color.xyz * light.color.w * attenuation;
+    vec3 lighting = intensity * cosAngIncidence;
+
+    if (SPECULAR_ENABLED) {
+        vec3 halfAngle = normalize(directionToLight + viewDirection);
+        float blinnTerm = dot(surfaceNormal, halfAngle);
+        blinnTerm = clamp(blinnTerm, 0, 1);
+        blinnTerm = pow(blinnTerm, 512.0);
+
+        lighting += intensity * blinnTerm;
+    }
+
+    outColor = vec4(lighting * albedo, 0.0);
+}
\ No newline at end of file
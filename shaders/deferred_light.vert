@@ -0,0 +1,43 @@
+#version 450
+
+layout(location = 0) out vec3 fragPosView;
+layout(location = 1) flat out uint fragLightIndex;
+
+// Only the leading members of the global UBO are declared, the offsets match shader.vert
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+} ubo;
+
+struct PointLightData {
+    vec3 position;
+    float range;
+    vec4 color;
+    float radius;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer PointLightBuffer {
+    PointLightData lights[];
+};
+
+// A cube around the light's range. Corner i has x, y and z at -1 or +1 from bits 0, 1 and 2, the triangles
+// wind counter-clockwise seen from outside.
+const int CUBE_INDICES[36] = int[](
+    4, 6, 2, 4, 2, 0,
+    1, 3, 7, 1, 7, 5,
+    0, 1, 5, 0, 5, 4,
+    6, 7, 3, 6, 3, 2,
+    2, 3, 1, 2, 1, 0,
+    4, 5, 7, 4, 7, 6
+);
+
+void main() {
+    PointLightData light = lights[gl_InstanceIndex];
+    int corner = CUBE_INDICES[gl_VertexIndex];
+    vec3 offset = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1) * 2.0 - 1.0;
+
+    vec4 positionView = ubo.view * vec4(light.position + offset * light.range, 1.0);
+    gl_Position = ubo.projection * positionView;
+    fragPosView = positionView.xyz;
+    fragLightIndex = gl_InstanceIndex;
+}
\ No newline at end of file
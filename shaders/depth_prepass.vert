@@ -0,0 +1,27 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+
+// Must compute gl_Position exactly like shader.vert for the EQUAL depth test of the color pass
+invariant gl_Position;
+
+// Only the leading members of the global UBO are declared, the offsets match shader.vert
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+} ubo;
+
+// Same object buffer as shader.vert
+struct ObjectData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+void main() {
+    vec4 positionWorld = objects[gl_InstanceIndex].modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projection * ubo.view * positionWorld;
+}
@@ -1,30 +1,10 @@
 #version 450
 
 layout(location = 0) in vec2 fragOffset;
+layout(location = 1) flat in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
-layout(set = 0, binding = 0) uniform GlobalUbo {
-    mat4 projection;
-    mat4 view;
-    mat4 inverseView;
-    vec4 ambientLightColor;
-    // TODO: Use specialization constant for number of lights
-    PointLight pointLights[10];
-    int numLights;
-} ubo;
-
-layout(push_constant) uniform Push {
-    vec4 position;
-    vec4 color;
-    float radius;
-} push;
-
 const float M_PI = 3.1415926538;
 
 void main() {
@@ -33,5 +13,5 @@ void main() {
     if (dis >= 1) {
         discard;
     }
-    outColor = vec4(push.color.xyz, 0.5 * (cos(dis * M_PI) + 1.0));
+    outColor = vec4(fragColor, 0.5 * (cos(dis * M_PI) + 1.0));
 }
\ No newline at end of file
@@ -1,27 +1,25 @@
 #version 450
 
 layout(location = 0) out vec2 fragOffset;
+layout(location = 1) flat out vec3 fragColor;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
+// Only the leading members of the global UBO are declared, the offsets match shader.frag
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
-    mat4 inverseView;
-    vec4 ambientLightColor;
-    // TODO: Use specialization constant for number of lights
-    PointLight pointLights[10];
-    int numLights;
 } ubo;
 
-layout(push_constant) uniform Push {
-    vec4 position;
+struct PointLightData {
+    vec3 position;
+    float range;
     vec4 color;
     float radius;
-} push;
+};
+
+// Every light in the scene, one billboard instance each
+layout(std430, set = 0, binding = 1) readonly buffer PointLightBuffer {
+    PointLightData lights[];
+};
 
 const vec2 OFFSETS[6] = vec2[](
   vec2(-1.0, -1.0),
@@ -33,14 +31,16 @@ const vec2 OFFSETS[6] = vec2[](
 );
 
 void main() {
+    PointLightData light = lights[gl_InstanceIndex];
     fragOffset = OFFSETS[gl_VertexIndex];
+    fragColor = light.color.xyz;
 
     vec3 cameraRightWorld = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
     vec3 cameraUpWorld = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
 
-    vec3 positionWorld = push.position.xyz 
-        + push.radius * fragOffset.x * cameraRightWorld
-        + push.radius * fragOffset.y * cameraUpWorld;
+    vec3 positionWorld = light.position
+        + light.radius * fragOffset.x * cameraRightWorld
+        + light.radius * fragOffset.y * cameraUpWorld;
 
     gl_Position = ubo.projection * ubo.view * vec4(positionWorld, 1.0);
 }
\ No newline at end of file
@@ -6,25 +6,54 @@ layout(location = 2) in vec3 fragNormalWorld;
 
 layout(location = 0) out vec4 outColor;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
+layout(constant_id = 1) const bool SPECULAR_ENABLED = true;
+layout(constant_id = 2) const bool AMBIENT_ONLY = false;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     mat4 inverseView;
     vec4 ambientLightColor;
-    // TODO: Use specialization constant for number of lights
-    PointLight pointLights[10];
-    int numLights;
 } ubo;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
+struct PointLightData {
+    vec3 position;
+    float range;
+    vec4 color;
+    float radius;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer PointLightBuffer {
+    PointLightData lights[];
+};
+
+// Must match light_cluster.comp
+const uvec3 CLUSTER_GRID = uvec3(16, 9, 24);
+const uint CLUSTER_COUNT = CLUSTER_GRID.x * CLUSTER_GRID.y * CLUSTER_GRID.z;
+
+// Filled by light_cluster.comp earlier in the frame
+layout(std430, set = 0, binding = 2) readonly buffer ClusterBuffer {
+    uint indexCount;
+    uint overflowCount;
+    uint cappedCount;
+    uvec2 clusters[CLUSTER_COUNT];
+    uint lightIndices[];
+};
+
+uint clusterIndex(vec3 positionWorld) {
+    vec4 positionView = ubo.view * vec4(positionWorld, 1.0);
+    vec4 positionClip = ubo.projection * positionView;
+    vec2 ndc = positionClip.xy / positionClip.w;
+
+    float near = -ubo.projection[3][2] / ubo.projection[2][2];
+    float far = ubo.projection[3][2] / (1.0 - ubo.projection[2][2]);
+    float slice = log(positionView.z / near) / log(far / near) * CLUSTER_GRID.z;
+
+    uvec3 cluster = uvec3(clamp(ivec3(vec3((ndc * 0.5 + 0.5) * vec2(CLUSTER_GRID.xy), slice)),
+                                ivec3(0),
+                                ivec3(CLUSTER_GRID) - 1));
+    return cluster.x + CLUSTER_GRID.x * (cluster.y + CLUSTER_GRID.y * cluster.z);
+}
 
 void main() {
     vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
@@ -34,25 +63,35 @@ void main() {
     vec3 cameraPosWorld = ubo.inverseView[3].xyz;
     vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
 
-    for (int i = 0; i < ubo.numLights; i++) {
-        PointLight light = ubo.pointLights[i];
-        vec3 directionToLight = light.position.xyz - fragPosWorld;
-        float attenuation = 1.0 / dot(directionToLight, directionToLight);
-        directionToLight = normalize(directionToLight);   
+    if (!AMBIENT_ONLY) {
+        uvec2 cluster = clusters[clusterIndex(fragPosWorld)];
+        for (uint i = 0; i < cluster.y; i++) {
+            PointLightData light = lights[lightIndices[cluster.x + i]];
+            vec3 directionToLight = light.position - fragPosWorld;
+            float distanceSquared = dot(directionToLight, directionToLight);
+            // Inverse square, windowed so that it reaches zero at the light's range instead of being cut off
+            float rangeSquared = light.range * light.range;
+            float falloff = 1.0 - distanceSquared * distanceSquared / (rangeSquared * rangeSquared);
+            falloff = clamp(falloff, 0.0, 1.0);
+            float attenuation = falloff * falloff / distanceSquared;
+            directionToLight = normalize(directionToLight);
 
-        // diffuse light
-        float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0.0);
-        vec3 intensity = light.color.xyz * light.color.w * attenuation;
+            // diffuse light
+            float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0.0);
+            vec3 intensity = light.color.xyz * light.color.w * attenuation;
 
-        diffuseLight += intensity * cosAngIncidence;
+            diffuseLight += intensity * cosAngIncidence;
 
-        // specular light
-        vec3 halfAngle = normalize(directionToLight + viewDirection);
-        float blinnTerm = dot(surfaceNormal, halfAngle);
-        blinnTerm = clamp(blinnTerm, 0, 1);
-        blinnTerm = pow(blinnTerm, 512.0);
+            // specular light
+            if (SPECULAR_ENABLED) {
+                vec3 halfAngle = normalize(directionToLight + viewDirection);
+                float blinnTerm = dot(surfaceNormal, halfAngle);
+                blinnTerm = clamp(blinnTerm, 0, 1);
+                blinnTerm = pow(blinnTerm, 512.0);
 
-        specularLight += intensity * blinnTerm;
+                specularLight += intensity * blinnTerm;
+            }
+        }
     }
 
     outColor = vec4(diffuseLight * fragColor + specularLight * fragColor, 1.0);
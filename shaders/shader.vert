@@ -5,35 +5,36 @@ layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
 
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
+// Matches depth_prepass.vert bit for bit, the depth pre-pass relies on it
+invariant gl_Position;
 
+// Only the leading members of the global UBO are declared, the offsets match shader.frag
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
-    mat4 inverseView;
-    vec4 ambientLightColor;
-    // TODO: Use specialization constant for number of lights
-    PointLight pointLights[10];
-    int numLights;
 } ubo;
 
-layout(push_constant) uniform Push {
+struct ObjectData {
     mat4 modelMatrix;
     mat4 normalMatrix;
-} push;
+};
+
+// Objects are laid out in draw order, so the instance index (first instance included) selects one
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
 
 void main() {
-    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+    ObjectData object = objects[gl_InstanceIndex];
+    vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
     gl_Position = ubo.projection * ubo.view * positionWorld;
 
-    fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+    fragNormalWorld = normalize(mat3(object.normalMatrix) * normal);
     fragPosWorld = positionWorld.xyz;
     fragColor = color;
 }
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include "Buffer.h"
 #include "Camera.h"
-#include "KeyboardMovementController.h"
+#include "Utils.h"
+#include "systems/DeferredLightingSystem.h"
+#include "systems/LightClusterSystem.h"
 #include "systems/PointLightSystem.h"
 #include "systems/RenderSystem.h"
 
@@ -12,18 +14,75 @@
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <ctime>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
+#include <iostream>
+#include <random>
 #include <stdexcept>
 
 namespace vge {
 
-Application::Application() {
-    _globalPool = DescriptorPool::Builder(_device)
-                      .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
-                      .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
-                      .build();
+// Nearest-rank percentile in (0, 1], 1 giving the maximum. 0 for no frames.
+static float frameTimePercentile(std::vector<float> frameTimes, float percentile) {
+    if (frameTimes.empty()) {
+        return 0.0f;
+    }
+    auto rank = static_cast<size_t>(std::ceil(percentile * frameTimes.size()));
+    auto nth = frameTimes.begin() + (std::max<size_t>(rank, 1) - 1);
+    std::nth_element(frameTimes.begin(), nth, frameTimes.end());
+    return *nth;
+}
+
+Application::Application()
+    : Application(defaultConfig()) {}
+
+Application::Application(const Config& config)
+    : _config{config} {
+    const ShadingPath shadingPath = _config.shading.deferred ? ShadingPath::Deferred : ShadingPath::Forward;
+    if (_config.headless) {
+        _device = std::make_unique<Device>();
+    } else {
+        _window = std::make_unique<Window>(WIDTH, HEIGHT, "Vulkan Game Engine");
+        _device = std::make_unique<Device>(*_window);
+    }
+
+    // GPU occlusion culling samples the forward depth buffer between two render passes. RenderSystem falls
+    // back to plain GPU culling under the same conditions that leave it off here.
+    const bool depthSampling = _config.culling == RenderSystem::CullingMode::Occlusion && _config.gpuDriven &&
+                               !_config.shading.deferred && _device->supportsMultiDrawIndirect();
+    if (_config.headless) {
+        _renderer =
+            std::make_unique<Renderer>(*_device, VkExtent2D{WIDTH, HEIGHT}, shadingPath, depthSampling);
+    } else {
+        _renderer = std::make_unique<Renderer>(*_window, *_device, shadingPath, depthSampling);
+    }
+    _pipelineCompiler = std::make_unique<PipelineCompiler>(*_device);
+    _pipelineRegistry = std::make_unique<PipelineRegistry>(*_device, *_pipelineCompiler);
+    _pipelineRegistry->getBlobStore().openArchive();
+    if (_config.hotReload) {
+        _shaderHotReloader = std::make_unique<ShaderHotReloader>();
+    }
+
+    _globalDescriptorAllocator = std::make_unique<DescriptorAllocator>(
+        *_device,
+        SwapChain::MAX_FRAMES_IN_FLIGHT,
+        std::vector<DescriptorAllocator::PoolSizeRatio>{{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+                                                        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f}});
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        _frameDescriptorAllocators.push_back(std::make_unique<DescriptorAllocator>(
+            *_device,
+            FRAME_DESCRIPTOR_SETS,
+            std::vector<DescriptorAllocator::PoolSizeRatio>{{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+                                                            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+                                                            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+                                                            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f}}));
+    }
     loadGameObjects();
+    if (_config.gpuDriven) {
+        createMeshPool();
+    }
 }
 
 Application::~Application() {}
@@ -32,7 +91,7 @@ void Application::run() {
     std::vector<std::unique_ptr<Buffer>> uniformBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
 
     for (size_t i = 0; i < uniformBuffers.size(); i++) {
-        uniformBuffers[i] = std::make_unique<Buffer>(_device,
+        uniformBuffers[i] = std::make_unique<Buffer>(*_device,
                                                      sizeof(GlobalUbo),
                                                      SwapChain::MAX_FRAMES_IN_FLIGHT,
                                                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -41,77 +100,410 @@ void Application::run() {
         uniformBuffers[i]->map();
     }
 
-    auto globalSetLayout = DescriptorSetLayout::Builder(_device)
-                               .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-                               .build();
+    // Every point light, filled by PointLightSystem::update in the same pass as the UBO
+    std::vector<std::unique_ptr<Buffer>> lightBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (auto& lightBuffer : lightBuffers) {
+        lightBuffer = std::make_unique<Buffer>(*_device,
+                                               sizeof(PointLightData),
+                                               MAX_POINT_LIGHTS,
+                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        lightBuffer->map();
+    }
+
+    // The light binning pass reads the camera and the lights from the same set the shaders do
+    const VkShaderStageFlags globalStages = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+    const VkShaderStageFlags clusterStages = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    auto globalSetLayout = DescriptorSetLayout::Builder(*_device)
+                               .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, globalStages)
+                               .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, globalStages)
+                               .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, clusterStages)
+                               .build(_pipelineRegistry->getLayoutCache());
+
+    LightClusterSystem lightClusterSystem{
+        *_device, *_pipelineRegistry, globalSetLayout->getDescriptorSetLayout()};
 
     std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
 
     for (size_t i = 0; i < globalDescriptorSets.size(); i++) {
         auto bufferInfo = uniformBuffers[i]->descriptorInfo();
-        DescriptorWriter(*globalSetLayout, *_globalPool)
+        auto lightBufferInfo = lightBuffers[i]->descriptorInfo();
+        auto clusterBufferInfo = lightClusterSystem.getClusterBuffer(static_cast<int>(i)).descriptorInfo();
+        DescriptorWriter(*globalSetLayout, *_globalDescriptorAllocator)
             .writeBuffer(0, &bufferInfo)
+            .writeBuffer(1, &lightBufferInfo)
+            .writeBuffer(2, &clusterBufferInfo)
             .build(globalDescriptorSets[i]);
     }
 
-    RenderSystem renderSystem{
-        _device, _renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+    // Both pipelines compile in parallel while the rest of the setup runs
+    RenderSystem renderSystem{*_device,
+                              *_pipelineRegistry,
+                              _renderer->getSwapChainRenderPass(),
+                              _renderer->getSwapChainRenderPassSignature(),
+                              globalSetLayout->getDescriptorSetLayout(),
+                              _config.shading,
+                              _meshPool.get(),
+                              _config.culling};
+
+    const bool deferred = _renderer->getShadingPath() == ShadingPath::Deferred;
+    PointLightSystem pointLightSystem{*_device,
+                                      *_pipelineRegistry,
+                                      _renderer->getSwapChainRenderPass(),
+                                      _renderer->getSwapChainRenderPassSignature(),
+                                      globalSetLayout->getDescriptorSetLayout(),
+                                      deferred ? GBuffer::LIGHTING_SUBPASS : 0};
+
+    std::unique_ptr<DeferredLightingSystem> deferredLightingSystem;
+    if (deferred) {
+        deferredLightingSystem =
+            std::make_unique<DeferredLightingSystem>(*_device,
+                                                     *_pipelineRegistry,
+                                                     _renderer->getSwapChainRenderPass(),
+                                                     _renderer->getSwapChainRenderPassSignature(),
+                                                     globalSetLayout->getDescriptorSetLayout(),
+                                                     _config.shading);
+    }
 
-    PointLightSystem pointLightSystem{
-        _device, _renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+    _viewerObject.transform.translation.z = -2.5f;
 
-    Camera camera{};
+    std::vector<uint8_t> capturedFrame;
+    auto captureFrame = [&capturedFrame](const void* pixels, VkExtent2D extent) {
+        auto bytes = static_cast<const uint8_t*>(pixels);
+        capturedFrame.assign(bytes, bytes + static_cast<size_t>(extent.width) * extent.height * 4);
+    };
 
-    auto viewerObject = GameObject::createGameObject();
-    viewerObject.transform.translation.z = -2.5f;
-    KeyBoardMovementController cameraController{};
+    FrameSnapshot* renderSnapshot = &_snapshots[0];
+    FrameSnapshot* simulationSnapshot = &_snapshots[1];
+    simulate(0.0f, _renderer->getAspectRatio(), InputState{}, *renderSnapshot);
 
     auto currentTime = std::chrono::high_resolution_clock::now();
+    auto startTime = currentTime;
+    auto startCpuTime = std::clock();
+    uint32_t framesRendered = 0;
+    uint32_t framesSkipped = 0;
+    float totalSimulationTime = 0.0f;
+    float totalRenderTime = 0.0f;
+    RenderSystem::FrameStats totalRenderStats{};
+    CommandRecorder::Stats totalRecorderStats{};
+    bool isIdle = false;
+    const bool idleSkipping = _config.idleSkipping && _window != nullptr;
+
+    const bool resizeTest = _config.resizeTestCount > 0 && _window != nullptr;
+    uint32_t resizeCount = 0;
+    uint32_t loopIndex = 0;
+    // Loop iterations from a resize to RESIZE_TEST_SETTLE_FRAMES after it, and all others
+    std::vector<float> resizeFrameTimes;
+    std::vector<float> steadyFrameTimes;
+
+    while (_window != nullptr ? !_window->shouldClose() : framesRendered < _config.frameCount) {
+        auto loopStart = std::chrono::high_resolution_clock::now();
+        float frameTime = HEADLESS_FRAME_TIME;
+        InputState input{};
+
+        if (resizeTest && loopIndex % RESIZE_TEST_INTERVAL == 0) {
+            if (resizeCount == _config.resizeTestCount) {
+                break;
+            }
+            // Alternates between the default size and three quarters of it
+            bool shrink = resizeCount++ % 2 == 0;
+            _window->setSize(shrink ? WIDTH * 3 / 4 : WIDTH, shrink ? HEIGHT * 3 / 4 : HEIGHT);
+        }
 
-    while (!_window.shouldClose()) {
-        glfwPollEvents();
+        if (_window != nullptr) {
+            if (isIdle) {
+                glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+            } else {
+                glfwPollEvents();
+            }
+            input = _window->getInputState();
+
+            auto newTime = std::chrono::high_resolution_clock::now();
+            frameTime =
+                std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
+            currentTime = newTime;
+
+            // Time spent blocked on input must not turn into one huge movement step
+            if (isIdle) {
+                frameTime = std::min(frameTime, MAX_IDLE_FRAME_TIME);
+            }
+        }
+
+        // In serial mode the snapshot is simulated and then rendered within the same iteration
+        FrameSnapshot* simulated = _config.pipelined ? simulationSnapshot : renderSnapshot;
+        float aspect = _renderer->getAspectRatio();
+        auto simulation = _simulationThread.submit([this, frameTime, aspect, input, simulated]() {
+            auto start = std::chrono::high_resolution_clock::now();
+            simulate(frameTime, aspect, input, *simulated);
+            return std::chrono::duration<float, std::chrono::milliseconds::period>(
+                       std::chrono::high_resolution_clock::now() - start)
+                .count();
+        });
+        if (!_config.pipelined) {
+            simulation.wait();
+        }
+
+        const FrameSnapshot& snapshot = *renderSnapshot;
+        auto renderStart = std::chrono::high_resolution_clock::now();
+
+        // Frame boundary: no command buffer is being recorded, so pipelines can be swapped safely
+        bool pipelinesChanged = false;
+        if (_shaderHotReloader != nullptr) {
+            auto recompiled = _shaderHotReloader->takeRecompiledShaders();
+            if (!recompiled.empty()) {
+                _pipelineRegistry->reloadShaders(recompiled);
+            }
+            pipelinesChanged = _pipelineRegistry->applyReloads(_renderer->getSubmittedFrameCount());
+        }
 
-        auto newTime = std::chrono::high_resolution_clock::now();
-        auto frameTime =
-            std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
-        currentTime = newTime;
+        bool shouldRender = true;
+        if (idleSkipping) {
+            // The last presented image stays on screen, so an unchanged scene needs no new frame
+            shouldRender = snapshot.sceneChanged || pipelinesChanged || _window->wasResized() ||
+                           _window->wasRefreshRequested();
+            _window->resetRefreshRequestedFlag();
+        }
 
-        cameraController.moveInPlaneXZ(_window.getGLFWWindow(), frameTime, viewerObject);
-        camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+        // Runs on worker threads alongside the simulation and the wait for the frame's fence
+        if (shouldRender) {
+            renderSystem.beginOcclusionCulling(snapshot);
+        }
 
-        float aspect = _renderer.getAspectRatio();
-        camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
+        // Only the last headless frame is copied back, the others never leave the GPU
+        if (_window == nullptr && !_config.capturePath.empty() && framesRendered + 1 == _config.frameCount) {
+            _renderer->setFrameReadbackCallback(captureFrame);
+        }
 
-        if (auto commandBuffer = _renderer.beginFrame()) {
-            int frameIndex = _renderer.getFrameIndex();
-            FrameInfo frameInfo{
-                frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex], _gameObjects};
+        VkCommandBuffer commandBuffer = shouldRender ? _renderer->beginFrame() : nullptr;
+        if (commandBuffer != nullptr) {
+            int frameIndex = _renderer->getFrameIndex();
+            // The frame's fence was waited on, nothing can still be using its sets
+            _frameDescriptorAllocators[frameIndex]->reset();
+            FrameInfo frameInfo{frameIndex,
+                                snapshot.frameTime,
+                                commandBuffer,
+                                _renderer->getCommandRecorder(),
+                                snapshot.camera,
+                                globalDescriptorSets[frameIndex],
+                                snapshot,
+                                _renderer->getExtent(),
+                                *_frameDescriptorAllocators[frameIndex]};
 
             GlobalUbo ubo{};
-            ubo.projection = camera.getProjectionMatrix();
-            ubo.view = camera.getViewMatrix();
-            ubo.inverseView = camera.getInverseViewMatrix();
-            pointLightSystem.update(frameInfo, ubo);
+            ubo.projection = snapshot.camera.getProjectionMatrix();
+            ubo.view = snapshot.camera.getViewMatrix();
+            ubo.inverseView = snapshot.camera.getInverseViewMatrix();
+            pointLightSystem.update(frameInfo, *lightBuffers[frameIndex]);
 
             uniformBuffers[frameIndex]->writeToBuffer(&ubo);
             uniformBuffers[frameIndex]->flush();
 
-            _renderer.beginSwapChainRenderPass(commandBuffer);
+            // The deferred path lights through volumes and has no use for the clusters
+            if (!deferred) {
+                lightClusterSystem.buildClusters(frameInfo, pointLightSystem.getLightCount());
+            }
+            renderSystem.prepareGameObjects(frameInfo);
+
+            _renderer->beginSwapChainRenderPass(commandBuffer);
 
             renderSystem.renderGameObjects(frameInfo);
+            if (renderSystem.hasLatePass()) {
+                // Leaves the render pass so the depth drawn so far can occlude the remaining objects
+                _renderer->endSwapChainRenderPass(commandBuffer);
+                renderSystem.cullOccludedGameObjects(frameInfo, _renderer->getDepthAttachment());
+                _renderer->resumeSwapChainRenderPass(commandBuffer);
+                renderSystem.renderLateGameObjects(frameInfo);
+            }
+            const auto& renderStats = renderSystem.getFrameStats();
+            totalRenderStats.sortTime += renderStats.sortTime;
+            totalRenderStats.pipelineBinds += renderStats.pipelineBinds;
+            totalRenderStats.descriptorSetBinds += renderStats.descriptorSetBinds;
+            totalRenderStats.vertexBufferBinds += renderStats.vertexBufferBinds;
+            totalRenderStats.indexBufferBinds += renderStats.indexBufferBinds;
+            totalRenderStats.draws += renderStats.draws;
+            totalRenderStats.occludedCount += renderStats.occludedCount;
+            totalRenderStats.occlusionRasterTime += renderStats.occlusionRasterTime;
+            totalRenderStats.occlusionTestTime += renderStats.occlusionTestTime;
+            if (deferred) {
+                _renderer->nextSubpass(commandBuffer);
+                deferredLightingSystem->render(
+                    frameInfo, _renderer->getGBufferAttachments(), pointLightSystem.getLightCount());
+            }
             pointLightSystem.render(frameInfo);
 
-            _renderer.endSwapChainRenderPass(commandBuffer);
-            _renderer.endFrame();
+            _renderer->endSwapChainRenderPass(commandBuffer);
+            const auto& recorderStats = frameInfo.recorder.getStats();
+            totalRecorderStats.issued += recorderStats.issued;
+            totalRecorderStats.elided += recorderStats.elided;
+            _renderer->endFrame();
+            if (framesRendered++ == 0) {
+                _pipelineCompiler->printReport();
+                _pipelineRegistry->printStats();
+            }
+
+            totalRenderTime += std::chrono::duration<float, std::chrono::milliseconds::period>(
+                                   std::chrono::high_resolution_clock::now() - renderStart)
+                                   .count();
+        } else if (!shouldRender) {
+            ++framesSkipped;
+        }
+
+        // A frame that was not rendered leaves its cull running, and the snapshot may be simulated into next
+        renderSystem.finishOcclusionCulling();
+        // Rethrows anything the simulation threw
+        totalSimulationTime += simulation.get();
+
+        if (_config.pipelined) {
+            std::swap(renderSnapshot, simulationSnapshot);
+            // Don't block on input if the snapshot rendered next iteration already has changes
+            isIdle = !shouldRender && !renderSnapshot->sceneChanged;
+        } else {
+            isIdle = !shouldRender;
+        }
+
+        if (resizeTest) {
+            auto loopTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                                std::chrono::high_resolution_clock::now() - loopStart)
+                                .count();
+            bool aroundResize = loopIndex % RESIZE_TEST_INTERVAL <= RESIZE_TEST_SETTLE_FRAMES;
+            (aroundResize ? resizeFrameTimes : steadyFrameTimes).push_back(loopTime);
+        }
+        ++loopIndex;
+    }
+
+    _renderer->flushFrameReadbacks();
+    vkDeviceWaitIdle(_device->getVkDevice());
+
+    auto elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                       std::chrono::high_resolution_clock::now() - startTime)
+                       .count();
+    uint32_t loopCount = std::max(framesRendered + framesSkipped, 1u);
+    uint32_t frameCount = std::max(framesRendered, 1u);
+    std::cout << "Average frame " << elapsed / loopCount << "ms (simulation " << totalSimulationTime / loopCount
+              << "ms, render " << totalRenderTime / frameCount << "ms, "
+              << (_config.pipelined ? "pipelined" : "serial") << ")\n";
+
+    std::cout << "Per rendered frame: sort " << totalRenderStats.sortTime / frameCount << "ms, "
+              << totalRenderStats.pipelineBinds / frameCount << " pipeline binds, "
+              << totalRenderStats.descriptorSetBinds / frameCount << " descriptor set binds, "
+              << totalRenderStats.vertexBufferBinds / frameCount << " vertex buffer binds, "
+              << totalRenderStats.indexBufferBinds / frameCount << " index buffer binds, "
+              << totalRenderStats.draws / frameCount << " draws, " << totalRecorderStats.issued / frameCount
+              << " commands issued, " << totalRecorderStats.elided / frameCount << " redundant ones elided\n";
+
+    if (auto cullingSystem = renderSystem.getCullingSystem()) {
+        const auto& stats = cullingSystem->getStats();
+        std::cout << "GPU culling: " << stats.visibleCount << " objects visible, " << stats.culledCount
+                  << " culled";
+        if (cullingSystem->hasOcclusionCulling()) {
+            std::cout << " (" << stats.occludedCount << " of them occluded)";
         }
+        std::cout << "\n";
+    }
+
+    const auto& clusterStats = lightClusterSystem.getStats();
+    if (clusterStats.overflowCount > 0 || clusterStats.cappedCount > 0) {
+        std::cout << "Light clustering dropped " << clusterStats.cappedCount
+                  << " light-cluster pairs over the per-cluster cap and " << clusterStats.overflowCount
+                  << " for lack of index space\n";
+    }
+
+    if (auto occlusionCuller = renderSystem.getOcclusionCuller()) {
+        std::cout << "Software occlusion culling (" << OcclusionCuller::simdPath() << ", "
+                  << occlusionCuller->getStats().triangleCount << " occluder triangles): "
+                  << totalRenderStats.occludedCount / frameCount << " objects occluded, raster "
+                  << totalRenderStats.occlusionRasterTime / frameCount << "ms, test "
+                  << totalRenderStats.occlusionTestTime / frameCount << "ms per rendered frame\n";
+    }
+
+    if (idleSkipping) {
+        auto cpuTime = static_cast<float>(std::clock() - startCpuTime) / CLOCKS_PER_SEC;
+        std::cout << "Frames rendered: " << framesRendered << ", idle frames skipped: " << framesSkipped << " ("
+                  << 100.0f * framesSkipped / loopCount << "%)\n"
+                  << "CPU time: " << cpuTime << "s over " << elapsed / 1000.0f << "s wall time\n";
+    }
+
+    if (resizeTest) {
+        const auto& recreationStats = _renderer->getSwapChainRecreationStats();
+        std::cout << "Resize test: " << resizeCount << " resizes, " << recreationStats.count
+                  << " swap chain recreations (average "
+                  << recreationStats.totalTime / std::max(recreationStats.count, 1u) << "ms, max "
+                  << recreationStats.maxTime << "ms)\n"
+                  << "  around resizes: max " << frameTimePercentile(resizeFrameTimes, 1.0f) << "ms, p99 "
+                  << frameTimePercentile(resizeFrameTimes, 0.99f) << "ms\n"
+                  << "  otherwise:      max " << frameTimePercentile(steadyFrameTimes, 1.0f) << "ms, p99 "
+                  << frameTimePercentile(steadyFrameTimes, 0.99f) << "ms\n";
     }
 
-    vkDeviceWaitIdle(_device.getVkDevice());
+    if (_window == nullptr) {
+        std::cout << "Rendered " << framesRendered << " headless frames in " << elapsed << "ms ("
+                  << elapsed / frameCount << "ms per frame)\n";
+
+        if (!capturedFrame.empty()) {
+            Utils::writeImagePPM(_config.capturePath, capturedFrame.data(), WIDTH, HEIGHT);
+            std::cout << "Last frame written to " << _config.capturePath << '\n';
+        }
+    }
+}
+
+void Application::simulate(float frameTime, float aspectRatio, const InputState& input, FrameSnapshot& snapshot) {
+    _cameraController.moveInPlaneXZ(input, frameTime, _viewerObject);
+    _camera.setViewYXZ(_viewerObject.transform.translation, _viewerObject.transform.rotation);
+    _camera.setPerspectiveProjection(glm::radians(50.f), aspectRatio, 0.1f, 100.f);
+
+    if (_config.animateLights) {
+        auto rotateLight = glm::rotate(glm::mat4(1.0f), frameTime, {0.0f, -1.0f, 0.0f});
+        for (auto& [id, obj] : _gameObjects) {
+            if (!obj.pointLight) continue;
+
+            obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.0f));
+            obj.transform.dirty = true;
+        }
+    }
+
+    snapshot.frameTime = frameTime;
+    snapshot.camera = _camera;
+    snapshot.sceneChanged = _camera.isDirty();
+    snapshot.objects.clear();
+    snapshot.pointLights.clear();
+    _camera.clearDirty();
+
+    for (auto& [id, obj] : _gameObjects) {
+        snapshot.sceneChanged |= obj.transform.dirty;
+        obj.transform.dirty = false;
+
+        if (obj.pointLight) {
+            snapshot.pointLights.push_back({glm::vec4(obj.transform.translation, 1.0f),
+                                            glm::vec4(obj.color, obj.pointLight->lightIntensity),
+                                            obj.transform.scale.x,
+                                            obj.pointLight->range});
+        } else if (obj.model) {
+            snapshot.objects.push_back(
+                {obj.model.get(), obj.transform.mat4(), obj.transform.normalMatrix(), obj.occluder});
+        }
+    }
+}
+
+void Application::createMeshPool() {
+    if (!_device->supportsMultiDrawIndirect()) {
+        std::cout << "multiDrawIndirect not supported, drawing per model\n";
+        return;
+    }
+
+    std::vector<Model*> models;
+    for (auto& kv : _gameObjects) {
+        if (kv.second.model != nullptr) {
+            models.push_back(kv.second.model.get());
+        }
+    }
+
+    _meshPool = std::make_unique<MeshPool>(*_device, models);
 }
 
 void Application::loadGameObjects() {
     {
-        std::shared_ptr<Model> model = Model::createModelFromFile(_device, "../models/smooth_vase.obj");
+        std::shared_ptr<Model> model = Model::createModelFromFile(*_device, "../models/smooth_vase.obj");
         auto obj = GameObject::createGameObject();
         obj.model = model;
         obj.transform.translation = {-0.5f, 0.5f, 0.0f};
@@ -119,7 +511,7 @@ void Application::loadGameObjects() {
         _gameObjects.emplace(obj.getId(), std::move(obj));
     }
     {
-        std::shared_ptr<Model> model = Model::createModelFromFile(_device, "../models/smooth_vase.obj");
+        std::shared_ptr<Model> model = Model::createModelFromFile(*_device, "../models/smooth_vase.obj");
         auto obj = GameObject::createGameObject();
         obj.model = model;
         obj.transform.translation = {0.5f, 0.5f, 0.0f};
@@ -127,12 +519,14 @@ void Application::loadGameObjects() {
         _gameObjects.emplace(obj.getId(), std::move(obj));
     }
     {
-        std::shared_ptr<Model> model = Model::createModelFromFile(_device, "../models/quad.obj");
+        std::shared_ptr<Model> model = Model::createModelFromFile(*_device, "../models/quad.obj");
         auto obj = GameObject::createGameObject();
         obj.model = model;
         obj.transform.scale = {3.0f, 1.0f, 3.0f};
         obj.transform.translation = {0.0f, 0.5f, 0.0f};
         obj.color = {0.2f, 0.2f, 0.2f};
+        // The vases are concave around the neck, so the floor is the only occluder
+        obj.occluder = true;
         _gameObjects.emplace(obj.getId(), std::move(obj));
     }
 
@@ -154,6 +548,18 @@ void Application::loadGameObjects() {
         pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.0f, -1.0f, -1.0f, 1.0f));
         _gameObjects.emplace(pointLight.getId(), std::move(pointLight));
     }
+
+    // Small short-range lights scattered just above the floor
+    std::mt19937 random{7};
+    std::uniform_real_distribution<float> position{-1.5f, 1.5f};
+    std::uniform_real_distribution<float> channel{0.1f, 1.0f};
+    for (uint32_t i = 0; i < _config.extraLights; i++) {
+        auto pointLight =
+            GameObject::createPointLight(0.05f, 0.02f, {channel(random), channel(random), channel(random)});
+        pointLight.pointLight->range = 0.5f;
+        pointLight.transform.translation = {position(random), 0.4f, position(random)};
+        _gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+    }
 }
 
 }  // namespace vge
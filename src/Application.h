@@ -1,12 +1,23 @@
 #pragma once
 
+#include "Camera.h"
 #include "Device.h"
+#include "FrameInfo.h"
 #include "GameObject.h"
+#include "KeyboardMovementController.h"
+#include "MeshPool.h"
+#include "PipelineCompiler.h"
+#include "PipelineRegistry.h"
 #include "Renderer.h"
+#include "ShaderHotReloader.h"
+#include "ThreadPool.h"
+#include "systems/RenderSystem.h"
 #include "Window.h"
 #include "Descriptor.h"
 
+#include <array>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace vge {
@@ -14,8 +25,49 @@ class Application {
 public:
     static constexpr uint32_t WIDTH = 1024;
     static constexpr uint32_t HEIGHT = 768;
+    static constexpr float HEADLESS_FRAME_TIME = 1.0f / 60.0f;
+    // Longest step simulated after an idle wait, so time spent blocked on input doesn't jump the scene
+    static constexpr float MAX_IDLE_FRAME_TIME = 1.0f / 60.0f;
+    // How long an idle loop blocks waiting for input before checking the scene again
+    static constexpr double IDLE_WAIT_TIMEOUT = 0.25;
+    // Sets the first pool of each frame's descriptor allocator holds, later pools grow
+    static constexpr uint32_t FRAME_DESCRIPTOR_SETS = 64;
+    // Resize test: frames between two resizes, and frames after each that count as around it
+    static constexpr uint32_t RESIZE_TEST_INTERVAL = 30;
+    static constexpr uint32_t RESIZE_TEST_SETTLE_FRAMES = 5;
+
+    struct Config {
+        bool headless;
+        // Headless only: number of frames to render before exiting
+        uint32_t frameCount;
+        // Headless only: if set, the last frame is read back and written to this path as PPM
+        std::string capturePath;
+        // Windowed only: skip rendering while nothing in the scene changes and block on input instead
+        bool idleSkipping;
+        bool animateLights;
+        // Simulate the next frame on a worker thread while the current one is recorded and submitted
+        bool pipelined;
+        RenderSystem::ShadingOptions shading;
+        // Development: recompile edited shaders and swap the affected pipelines in while running
+        bool hotReload;
+        // Draw the scene from one shared mesh pool with a single indirect draw per pass, where supported
+        bool gpuDriven;
+        // Gpu only takes effect when rendering GPU-driven
+        RenderSystem::CullingMode culling;
+        // Scatters this many additional small lights over the scene to stress the light clustering
+        uint32_t extraLights;
+        // Windowed only: resizes the window this many times, then exits and reports the frame times around
+        // the resizes against the others
+        uint32_t resizeTestCount;
+    };
+
+    static Config defaultConfig() {
+        return {false, 100, "", false, true, true, {true, false, false, false}, false, false,
+                RenderSystem::CullingMode::Cpu, 0, 0};
+    }
 
     Application();
+    explicit Application(const Config& config);
     ~Application();
 
     Application(const Application&) = delete;
@@ -25,12 +77,36 @@ public:
 
 private:
     void loadGameObjects();
+    void createMeshPool();
+
+    // Runs on the simulation thread: the only place that mutates game objects and the camera once
+    // the main loop has started
+    void simulate(float frameTime, float aspectRatio, const InputState& input, FrameSnapshot& snapshot);
 
-    Window _window{WIDTH, HEIGHT, "Vulkan Game Engine"};
-    Device _device{_window};
-    Renderer _renderer{_window, _device};
+    Config _config;
+    // Null in headless mode
+    std::unique_ptr<Window> _window;
+    std::unique_ptr<Device> _device;
+    std::unique_ptr<Renderer> _renderer;
+    std::unique_ptr<PipelineCompiler> _pipelineCompiler;
+    std::unique_ptr<PipelineRegistry> _pipelineRegistry;
+    // Null unless hot reload is enabled
+    std::unique_ptr<ShaderHotReloader> _shaderHotReloader;
 
-    std::unique_ptr<DescriptorPool> _globalPool{};
+    std::unique_ptr<DescriptorAllocator> _globalDescriptorAllocator;
+    // One per frame in flight, reset at the start of the frame
+    std::vector<std::unique_ptr<DescriptorAllocator>> _frameDescriptorAllocators;
     GameObject::Map _gameObjects;
+    // Null unless rendering GPU-driven
+    std::unique_ptr<MeshPool> _meshPool;
+
+    Camera _camera{};
+    GameObject _viewerObject = GameObject::createGameObject();
+    KeyBoardMovementController _cameraController{};
+
+    // One snapshot being rendered, one being simulated. Declared before the simulation thread so
+    // that a job still running during unwinding never outlives them.
+    std::array<FrameSnapshot, 2> _snapshots{};
+    ThreadPool _simulationThread{1};
 };
 }  // namespace vge
@@ -5,6 +5,8 @@
 
 namespace vge {
 void Camera::setOrthographicProjection(float left, float right, float top, float bottom, float near, float far) {
+    const glm::mat4 previousProjection = _projectionMatrix;
+
     _projectionMatrix = glm::mat4{1.0f};
     _projectionMatrix[0][0] = 2.f / (right - left);
     _projectionMatrix[1][1] = 2.f / (bottom - top);
@@ -12,23 +14,30 @@ void Camera::setOrthographicProjection(float left, float right, float top, float
     _projectionMatrix[3][0] = -(right + left) / (right - left);
     _projectionMatrix[3][1] = -(bottom + top) / (bottom - top);
     _projectionMatrix[3][2] = -near / (far - near);
+
+    _dirty |= _projectionMatrix != previousProjection;
 }
 
 void Camera::setPerspectiveProjection(float fovy, float aspectRatio, float near, float far) {
     assert(glm::abs(aspectRatio - std::numeric_limits<float>::epsilon()) > 0.0f);
     const float tanHalfFovy = tan(fovy / 2.f);
+    const glm::mat4 previousProjection = _projectionMatrix;
+
     _projectionMatrix = glm::mat4{0.0f};
     _projectionMatrix[0][0] = 1.f / (aspectRatio * tanHalfFovy);
     _projectionMatrix[1][1] = 1.f / (tanHalfFovy);
     _projectionMatrix[2][2] = far / (far - near);
     _projectionMatrix[2][3] = 1.f;
     _projectionMatrix[3][2] = -(far * near) / (far - near);
+
+    _dirty |= _projectionMatrix != previousProjection;
 }
 
 void Camera::setViewDirection(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& up) {
     const glm::vec3 w{glm::normalize(direction)};
     const glm::vec3 u{glm::normalize(glm::cross(w, up))};
     const glm::vec3 v{glm::cross(w, u)};
+    const glm::mat4 previousView = _viewMatrix;
 
     _viewMatrix = glm::mat4{1.f};
     _viewMatrix[0][0] = u.x;
@@ -57,6 +66,8 @@ void Camera::setViewDirection(const glm::vec3& position, const glm::vec3& direct
     _inverseViewMatrix[3][0] = position.x;
     _inverseViewMatrix[3][1] = position.y;
     _inverseViewMatrix[3][2] = position.z;
+
+    _dirty |= _viewMatrix != previousView;
 }
 
 void Camera::setViewTarget(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) {
@@ -73,6 +84,7 @@ void Camera::setViewYXZ(const glm::vec3& position, const glm::vec3& rotation) {
     const glm::vec3 u{(c1 * c3 + s1 * s2 * s3), (c2 * s3), (c1 * s2 * s3 - c3 * s1)};
     const glm::vec3 v{(c3 * s1 * s2 - c1 * s3), (c2 * c3), (c1 * c3 * s2 + s1 * s3)};
     const glm::vec3 w{(c2 * s1), (-s2), (c1 * c2)};
+    const glm::mat4 previousView = _viewMatrix;
 
     _viewMatrix = glm::mat4{1.f};
     _viewMatrix[0][0] = u.x;
@@ -101,6 +113,25 @@ void Camera::setViewYXZ(const glm::vec3& position, const glm::vec3& rotation) {
     _inverseViewMatrix[3][0] = position.x;
     _inverseViewMatrix[3][1] = position.y;
     _inverseViewMatrix[3][2] = position.z;
+
+    _dirty |= _viewMatrix != previousView;
 }
 
+std::array<glm::vec4, 6> Camera::getFrustumPlanes() const {
+    // Gribb-Hartmann: each plane is a sum or difference of rows of the projection-view matrix. Depth
+    // runs from 0 to 1, so the near plane is the third row alone.
+    const glm::mat4 projectionView = getProjectionViewMatrix();
+    auto row = [&m = projectionView](int i) { return glm::vec4{m[0][i], m[1][i], m[2][i], m[3][i]}; };
+
+    std::array<glm::vec4, 6> planes{row(3) + row(0),
+                                    row(3) - row(0),
+                                    row(3) + row(1),
+                                    row(3) - row(1),
+                                    row(2),
+                                    row(3) - row(2)};
+    for (auto& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
 }  // namespace vge
\ No newline at end of file
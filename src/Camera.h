@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <array>
+
 namespace vge {
 class Camera {
 public:
@@ -27,9 +29,18 @@ public:
     inline const glm::mat4  getProjectionViewMatrix() const { return _projectionMatrix * _viewMatrix; }
     inline const glm::vec3  getPosition() const { return glm::vec3(_inverseViewMatrix[3]); }
 
+    // World-space planes (left, right, bottom, top, near, far) as (normal, distance) with unit normals
+    // pointing inwards: a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all six
+    std::array<glm::vec4, 6> getFrustumPlanes() const;
+
+    // Set whenever a setter actually changes the view or projection
+    inline bool isDirty() const { return _dirty; }
+    inline void clearDirty() { _dirty = false; }
+
 private:
     glm::mat4 _projectionMatrix{1.0f};
     glm::mat4 _viewMatrix{1.0f};
     glm::mat4 _inverseViewMatrix{1.0f};
+    bool _dirty{true};
 };
 }  // namespace vge
\ No newline at end of file
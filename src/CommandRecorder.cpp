@@ -0,0 +1,192 @@
+#include "CommandRecorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vge {
+
+void CommandRecorder::begin(VkCommandBuffer commandBuffer) {
+    _commandBuffer = commandBuffer;
+    _stats = {};
+    invalidate();
+}
+
+void CommandRecorder::invalidate() {
+    _bindPoints = {};
+    _vertexBuffers.fill(VK_NULL_HANDLE);
+    _vertexOffsets.fill(0);
+    _indexBuffer = VK_NULL_HANDLE;
+    _indexOffset = 0;
+    _indexType = VK_INDEX_TYPE_UINT32;
+    _hasViewport = false;
+    _hasScissor = false;
+    _pushLayout = VK_NULL_HANDLE;
+    _pushStageFlags = 0;
+    _pushOffset = 0;
+    _pushSize = 0;
+}
+
+CommandRecorder::BindPointState& CommandRecorder::getBindPointState(VkPipelineBindPoint bindPoint) {
+    return _bindPoints[bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? 1 : 0];
+}
+
+void CommandRecorder::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
+    auto& state = getBindPointState(bindPoint);
+    if (state.pipeline == pipeline) {
+        ++_stats.elided;
+        return;
+    }
+
+    state.pipeline = pipeline;
+    // A pipeline whose layout isn't push constant compatible disturbs the pushed values
+    _pushLayout = VK_NULL_HANDLE;
+    vkCmdBindPipeline(_commandBuffer, bindPoint, pipeline);
+    ++_stats.issued;
+}
+
+void CommandRecorder::bindDescriptorSets(VkPipelineBindPoint bindPoint,
+                                         VkPipelineLayout layout,
+                                         uint32_t firstSet,
+                                         uint32_t setCount,
+                                         const VkDescriptorSet* descriptorSets) {
+    auto& state = getBindPointState(bindPoint);
+    const bool tracked = firstSet + setCount <= MAX_DESCRIPTOR_SETS;
+
+    if (tracked && state.layout == layout &&
+        std::equal(descriptorSets, descriptorSets + setCount, state.descriptorSets.begin() + firstSet)) {
+        ++_stats.elided;
+        return;
+    }
+
+    // Sets bound with another layout may have been disturbed, so none of them is known anymore
+    if (state.layout != layout) {
+        state.layout = layout;
+        state.descriptorSets.fill(VK_NULL_HANDLE);
+    }
+    if (tracked) {
+        std::copy(descriptorSets, descriptorSets + setCount, state.descriptorSets.begin() + firstSet);
+    } else {
+        state.descriptorSets.fill(VK_NULL_HANDLE);
+    }
+
+    vkCmdBindDescriptorSets(
+        _commandBuffer, bindPoint, layout, firstSet, setCount, descriptorSets, 0, nullptr);
+    ++_stats.issued;
+}
+
+void CommandRecorder::bindVertexBuffers(uint32_t firstBinding,
+                                        uint32_t bindingCount,
+                                        const VkBuffer* buffers,
+                                        const VkDeviceSize* offsets) {
+    const bool tracked = firstBinding + bindingCount <= MAX_VERTEX_BINDINGS;
+    if (tracked && std::equal(buffers, buffers + bindingCount, _vertexBuffers.begin() + firstBinding) &&
+        std::equal(offsets, offsets + bindingCount, _vertexOffsets.begin() + firstBinding)) {
+        ++_stats.elided;
+        return;
+    }
+
+    if (tracked) {
+        std::copy(buffers, buffers + bindingCount, _vertexBuffers.begin() + firstBinding);
+        std::copy(offsets, offsets + bindingCount, _vertexOffsets.begin() + firstBinding);
+    } else {
+        _vertexBuffers.fill(VK_NULL_HANDLE);
+    }
+
+    vkCmdBindVertexBuffers(_commandBuffer, firstBinding, bindingCount, buffers, offsets);
+    ++_stats.issued;
+}
+
+void CommandRecorder::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+    if (_indexBuffer == buffer && _indexOffset == offset && _indexType == indexType) {
+        ++_stats.elided;
+        return;
+    }
+
+    _indexBuffer = buffer;
+    _indexOffset = offset;
+    _indexType = indexType;
+    vkCmdBindIndexBuffer(_commandBuffer, buffer, offset, indexType);
+    ++_stats.issued;
+}
+
+void CommandRecorder::setViewport(const VkViewport& viewport) {
+    if (_hasViewport && std::memcmp(&_viewport, &viewport, sizeof(VkViewport)) == 0) {
+        ++_stats.elided;
+        return;
+    }
+
+    _hasViewport = true;
+    _viewport = viewport;
+    vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
+    ++_stats.issued;
+}
+
+void CommandRecorder::setScissor(const VkRect2D& scissor) {
+    if (_hasScissor && std::memcmp(&_scissor, &scissor, sizeof(VkRect2D)) == 0) {
+        ++_stats.elided;
+        return;
+    }
+
+    _hasScissor = true;
+    _scissor = scissor;
+    vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+    ++_stats.issued;
+}
+
+void CommandRecorder::pushConstants(VkPipelineLayout layout,
+                                    VkShaderStageFlags stageFlags,
+                                    uint32_t offset,
+                                    uint32_t size,
+                                    const void* data) {
+    const bool sameRange =
+        _pushLayout == layout && _pushStageFlags == stageFlags && _pushOffset == offset && _pushSize == size;
+    if (sameRange && std::memcmp(_pushData.data(), data, size) == 0) {
+        ++_stats.elided;
+        return;
+    }
+
+    if (size <= MAX_PUSH_CONSTANT_SIZE) {
+        _pushLayout = layout;
+        _pushStageFlags = stageFlags;
+        _pushOffset = offset;
+        _pushSize = size;
+        std::memcpy(_pushData.data(), data, size);
+    } else {
+        _pushLayout = VK_NULL_HANDLE;
+    }
+
+    vkCmdPushConstants(_commandBuffer, layout, stageFlags, offset, size, data);
+    ++_stats.issued;
+}
+
+void CommandRecorder::draw(uint32_t vertexCount,
+                           uint32_t instanceCount,
+                           uint32_t firstVertex,
+                           uint32_t firstInstance) {
+    vkCmdDraw(_commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+    ++_stats.issued;
+}
+
+void CommandRecorder::drawIndexed(uint32_t indexCount,
+                                  uint32_t instanceCount,
+                                  uint32_t firstIndex,
+                                  int32_t vertexOffset,
+                                  uint32_t firstInstance) {
+    vkCmdDrawIndexed(_commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+    ++_stats.issued;
+}
+
+void CommandRecorder::drawIndexedIndirect(VkBuffer buffer,
+                                          VkDeviceSize offset,
+                                          uint32_t drawCount,
+                                          uint32_t stride) {
+    vkCmdDrawIndexedIndirect(_commandBuffer, buffer, offset, drawCount, stride);
+    ++_stats.issued;
+}
+
+void CommandRecorder::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+    vkCmdDispatch(_commandBuffer, groupCountX, groupCountY, groupCountZ);
+    ++_stats.issued;
+}
+
+}  // namespace vge
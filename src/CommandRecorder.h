@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+
+namespace vge {
+
+// Records into a command buffer while remembering the bound pipelines, descriptor sets, vertex and index
+// buffers, viewport, scissor and push constant contents, and drops every call that would not change them.
+// Systems record through it instead of calling vkCmd* directly, so they get the savings without tracking
+// state themselves.
+//
+// Descriptor sets only count as bound for the pipeline layout they were bound with: binding the same sets
+// with another layout is always issued, even where the layouts happen to be compatible. Likewise a push
+// after a pipeline bind is always issued, the new pipeline's layout may have disturbed the pushed values.
+class CommandRecorder {
+public:
+    static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+    static constexpr uint32_t MAX_VERTEX_BINDINGS = 4;
+    // The minimum maxPushConstantsSize every device supports
+    static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+
+    struct Stats {
+        uint32_t issued;
+        uint32_t elided;
+    };
+
+    // Starts tracking a command buffer that was just begun, so nothing is bound yet, and resets the stats
+    void begin(VkCommandBuffer commandBuffer);
+    // Forgets all tracked state. Needed after recording state commands on the buffer directly.
+    void invalidate();
+
+    inline VkCommandBuffer getCommandBuffer() const { return _commandBuffer; }
+    // Commands recorded and dropped since begin
+    inline const Stats& getStats() const { return _stats; }
+
+    void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+    void bindDescriptorSets(VkPipelineBindPoint bindPoint,
+                            VkPipelineLayout layout,
+                            uint32_t firstSet,
+                            uint32_t setCount,
+                            const VkDescriptorSet* descriptorSets);
+    void bindVertexBuffers(uint32_t firstBinding,
+                           uint32_t bindingCount,
+                           const VkBuffer* buffers,
+                           const VkDeviceSize* offsets);
+    void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+    void setViewport(const VkViewport& viewport);
+    void setScissor(const VkRect2D& scissor);
+    void pushConstants(VkPipelineLayout layout,
+                       VkShaderStageFlags stageFlags,
+                       uint32_t offset,
+                       uint32_t size,
+                       const void* data);
+
+    // Never elided, only counted
+    void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+    void drawIndexed(uint32_t indexCount,
+                     uint32_t instanceCount,
+                     uint32_t firstIndex,
+                     int32_t vertexOffset,
+                     uint32_t firstInstance);
+    void drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+    void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+
+private:
+    struct BindPointState {
+        VkPipeline pipeline;
+        VkPipelineLayout layout;
+        std::array<VkDescriptorSet, MAX_DESCRIPTOR_SETS> descriptorSets;
+    };
+
+    // Graphics or compute
+    BindPointState& getBindPointState(VkPipelineBindPoint bindPoint);
+
+    VkCommandBuffer _commandBuffer = VK_NULL_HANDLE;
+    Stats _stats{};
+
+    std::array<BindPointState, 2> _bindPoints{};
+
+    std::array<VkBuffer, MAX_VERTEX_BINDINGS> _vertexBuffers{};
+    std::array<VkDeviceSize, MAX_VERTEX_BINDINGS> _vertexOffsets{};
+    VkBuffer _indexBuffer;
+    VkDeviceSize _indexOffset;
+    VkIndexType _indexType;
+
+    bool _hasViewport;
+    VkViewport _viewport;
+    bool _hasScissor;
+    VkRect2D _scissor;
+
+    // Contents of the last push since the last pipeline bind, only elided when an identical push follows
+    VkPipelineLayout _pushLayout;
+    VkShaderStageFlags _pushStageFlags;
+    uint32_t _pushOffset;
+    uint32_t _pushSize;
+    std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> _pushData;
+};
+
+}  // namespace vge
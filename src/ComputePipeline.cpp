@@ -0,0 +1,45 @@
+#include "ComputePipeline.h"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace vge {
+
+ComputePipeline::ComputePipeline(Device& device,
+                                 std::shared_ptr<ShaderModule> shaderModule,
+                                 VkPipelineLayout pipelineLayout,
+                                 uint32_t pushConstantSize)
+    : _device{device}
+    , _shaderModule{std::move(shaderModule)} {
+    uint32_t shaderSize = _shaderModule->getReflection().pushConstantSize;
+    if (shaderSize > pushConstantSize) {
+        throw std::runtime_error(_shaderModule->getFilepath() + ": push constant block of " +
+                                 std::to_string(shaderSize) + " bytes exceeds the pipeline layout's " +
+                                 std::to_string(pushConstantSize) + " bytes!");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = _shaderModule->getShaderModule();
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineIndex = -1;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkResult result = vkCreateComputePipelines(
+        _device.getVkDevice(), _device.getPipelineCache(), 1, &pipelineInfo, nullptr, &_computePipeline);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+}
+
+ComputePipeline::~ComputePipeline() { vkDestroyPipeline(_device.getVkDevice(), _computePipeline, nullptr); }
+
+void ComputePipeline::bind(CommandRecorder& recorder) {
+    recorder.bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, _computePipeline);
+}
+
+}  // namespace vge
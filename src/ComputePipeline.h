@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+
+#include "CommandRecorder.h"
+#include "Device.h"
+#include "ShaderModule.h"
+
+namespace vge {
+
+// A single compute stage. Created synchronously: compute pipelines are small and needed before the first
+// frame anyway.
+class ComputePipeline {
+public:
+    // pushConstantSize is the size of the push constant range in pipelineLayout, checked against the shader
+    ComputePipeline(Device& device,
+                    std::shared_ptr<ShaderModule> shaderModule,
+                    VkPipelineLayout pipelineLayout,
+                    uint32_t pushConstantSize = 0);
+    ~ComputePipeline();
+
+    ComputePipeline(const ComputePipeline&) = delete;
+    ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+    void bind(CommandRecorder& recorder);
+
+    // Workgroups needed to cover itemCount invocations
+    static inline uint32_t groupCount(uint32_t itemCount, uint32_t groupSize) {
+        return (itemCount + groupSize - 1) / groupSize;
+    }
+
+private:
+    Device& _device;
+    VkPipeline _computePipeline;
+    std::shared_ptr<ShaderModule> _shaderModule;
+};
+
+}  // namespace vge
@@ -1,5 +1,8 @@
 #include "Descriptor.h"
 
+#include "Utils.h"
+
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -22,6 +25,10 @@ std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const
     return std::make_unique<DescriptorSetLayout>(_device, _bindings);
 }
 
+std::shared_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build(DescriptorLayoutCache &cache) const {
+    return cache.getLayout(_bindings);
+}
+
 // *************** Descriptor Set Layout *********************
 
 DescriptorSetLayout::DescriptorSetLayout(
@@ -49,6 +56,138 @@ DescriptorSetLayout::~DescriptorSetLayout() {
     vkDestroyDescriptorSetLayout(_device.getVkDevice(), _descriptorSetLayout, nullptr);
 }
 
+// *************** Descriptor Layout Cache *********************
+
+bool DescriptorLayoutCache::Signature::operator==(const Signature &other) const {
+    return std::equal(bindings.begin(),
+                      bindings.end(),
+                      other.bindings.begin(),
+                      other.bindings.end(),
+                      [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b) {
+                          return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+                                 a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags;
+                      });
+}
+
+size_t DescriptorLayoutCache::SignatureHash::operator()(const Signature &signature) const {
+    size_t seed = 0;
+    for (const auto &binding : signature.bindings) {
+        Utils::hashCombine(seed,
+                           binding.binding,
+                           static_cast<uint32_t>(binding.descriptorType),
+                           binding.descriptorCount,
+                           binding.stageFlags);
+    }
+    return seed;
+}
+
+std::shared_ptr<DescriptorSetLayout> DescriptorLayoutCache::getLayout(
+    const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings) {
+    Signature signature{};
+    for (const auto &kv : bindings) {
+        assert(kv.second.pImmutableSamplers == nullptr && "Immutable samplers are not part of the signature");
+        signature.bindings.push_back(kv.second);
+    }
+    std::sort(signature.bindings.begin(),
+              signature.bindings.end(),
+              [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b) {
+                  return a.binding < b.binding;
+              });
+
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto it = _layouts.find(signature);
+    if (it != _layouts.end()) {
+        ++_hits;
+        return it->second;
+    }
+
+    auto layout = std::make_shared<DescriptorSetLayout>(_device, bindings);
+    _layouts.emplace(std::move(signature), layout);
+    return layout;
+}
+
+size_t DescriptorLayoutCache::getLayoutCount() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _layouts.size();
+}
+
+uint32_t DescriptorLayoutCache::getHitCount() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _hits;
+}
+
+// *************** Pipeline Layout Cache *********************
+
+bool PipelineLayoutCache::Signature::operator==(const Signature &other) const {
+    return setLayouts == other.setLayouts &&
+           std::equal(pushConstantRanges.begin(),
+                      pushConstantRanges.end(),
+                      other.pushConstantRanges.begin(),
+                      other.pushConstantRanges.end(),
+                      [](const VkPushConstantRange &a, const VkPushConstantRange &b) {
+                          return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+                      });
+}
+
+size_t PipelineLayoutCache::SignatureHash::operator()(const Signature &signature) const {
+    size_t seed = 0;
+    for (auto setLayout : signature.setLayouts) {
+        Utils::hashCombine(seed, setLayout);
+    }
+    for (const auto &range : signature.pushConstantRanges) {
+        Utils::hashCombine(seed, range.stageFlags, range.offset, range.size);
+    }
+    return seed;
+}
+
+PipelineLayoutCache::~PipelineLayoutCache() {
+    for (const auto &kv : _layouts) {
+        vkDestroyPipelineLayout(_device.getVkDevice(), kv.second, nullptr);
+    }
+}
+
+VkPipelineLayout PipelineLayoutCache::getLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                                const std::vector<VkPushConstantRange> &pushConstantRanges) {
+    Signature signature{setLayouts, pushConstantRanges};
+
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto it = _layouts.find(signature);
+    if (it != _layouts.end()) {
+        ++_hits;
+        return it->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(_device.getVkDevice(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+    _layouts.emplace(std::move(signature), layout);
+    return layout;
+}
+
+bool PipelineLayoutCache::contains(VkPipelineLayout layout) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return std::any_of(
+        _layouts.begin(), _layouts.end(), [layout](const auto &kv) { return kv.second == layout; });
+}
+
+size_t PipelineLayoutCache::getLayoutCount() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _layouts.size();
+}
+
+uint32_t PipelineLayoutCache::getHitCount() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _hits;
+}
+
 // *************** Descriptor Pool Builder *********************
 
 DescriptorPool::Builder &DescriptorPool::Builder::addPoolSize(VkDescriptorType descriptorType,
@@ -102,8 +241,7 @@ bool DescriptorPool::allocateDescriptor(const VkDescriptorSetLayout descriptorSe
     allocInfo.pSetLayouts = &descriptorSetLayout;
     allocInfo.descriptorSetCount = 1;
 
-    // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-    // a new pool whenever an old pool fills up. But this is beyond our current scope
+    // Fails once the pool is full, DescriptorAllocator chains a new pool instead
     if (vkAllocateDescriptorSets(_device.getVkDevice(), &allocInfo, &descriptor) != VK_SUCCESS) {
         return false;
     }
@@ -117,11 +255,151 @@ void DescriptorPool::freeDescriptors(std::vector<VkDescriptorSet> &descriptors)
 
 void DescriptorPool::resetPool() { vkResetDescriptorPool(_device.getVkDevice(), _descriptorPool, 0); }
 
+// *************** Descriptor Allocator *********************
+
+DescriptorAllocator::DescriptorAllocator(Device &device,
+                                         uint32_t initialSetsPerPool,
+                                         std::vector<PoolSizeRatio> poolSizeRatios)
+    : _device{device}
+    , _poolSizeRatios{std::move(poolSizeRatios)}
+    , _setsPerPool{std::min(std::max(initialSetsPerPool, 1u), MAX_SETS_PER_POOL)} {}
+
+DescriptorAllocator::~DescriptorAllocator() {
+    for (auto *pools : {&_readyPools, &_fullPools}) {
+        for (VkDescriptorPool pool : *pools) {
+            vkDestroyDescriptorPool(_device.getVkDevice(), pool, nullptr);
+        }
+    }
+}
+
+VkDescriptorPool DescriptorAllocator::getPool() {
+    if (!_readyPools.empty()) {
+        return _readyPools.back();
+    }
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const auto &ratio : _poolSizeRatios) {
+        const auto count = static_cast<uint32_t>(ratio.descriptorsPerSet * static_cast<float>(_setsPerPool));
+        poolSizes.push_back({ratio.descriptorType, std::max(count, 1u)});
+    }
+
+    VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+    descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    descriptorPoolInfo.pPoolSizes = poolSizes.data();
+    descriptorPoolInfo.maxSets = _setsPerPool;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(_device.getVkDevice(), &descriptorPoolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+    _readyPools.push_back(pool);
+    _setsPerPool = std::min(_setsPerPool * 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(const DescriptorSetLayout &setLayout) {
+    VkDescriptorSetLayout descriptorSetLayout = setLayout.getDescriptorSetLayout();
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = getPool();
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+    allocInfo.descriptorSetCount = 1;
+
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(_device.getVkDevice(), &allocInfo, &set);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        // Retired until the next reset, a fresh pool takes its place
+        _fullPools.push_back(_readyPools.back());
+        _readyPools.pop_back();
+        allocInfo.descriptorPool = getPool();
+        result = vkAllocateDescriptorSets(_device.getVkDevice(), &allocInfo, &set);
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor set!");
+    }
+    return set;
+}
+
+void DescriptorAllocator::reset() {
+    for (VkDescriptorPool pool : _readyPools) {
+        vkResetDescriptorPool(_device.getVkDevice(), pool, 0);
+    }
+    for (VkDescriptorPool pool : _fullPools) {
+        vkResetDescriptorPool(_device.getVkDevice(), pool, 0);
+        _readyPools.push_back(pool);
+    }
+    _fullPools.clear();
+}
+
+// *************** Descriptor Update Template *********************
+
+DescriptorUpdateTemplate::Builder &DescriptorUpdateTemplate::Builder::addEntry(uint32_t binding,
+                                                                               size_t offset,
+                                                                               size_t stride) {
+    assert(_setLayout._bindings.count(binding) == 1 && "Layout does not contain specified binding");
+    const auto &bindingDescription = _setLayout._bindings.at(binding);
+
+    const bool isImage = bindingDescription.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER ||
+                         bindingDescription.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+                         bindingDescription.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+                         bindingDescription.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+                         bindingDescription.descriptorType == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+
+    VkDescriptorUpdateTemplateEntry entry{};
+    entry.dstBinding = binding;
+    entry.dstArrayElement = 0;
+    entry.descriptorCount = bindingDescription.descriptorCount;
+    entry.descriptorType = bindingDescription.descriptorType;
+    entry.offset = offset;
+    if (stride != 0) {
+        entry.stride = stride;
+    } else {
+        entry.stride = isImage ? sizeof(VkDescriptorImageInfo) : sizeof(VkDescriptorBufferInfo);
+    }
+    _entries.push_back(entry);
+    return *this;
+}
+
+std::unique_ptr<DescriptorUpdateTemplate> DescriptorUpdateTemplate::Builder::build() const {
+    return std::make_unique<DescriptorUpdateTemplate>(_device, _setLayout, _entries);
+}
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(
+    Device &device,
+    const DescriptorSetLayout &setLayout,
+    const std::vector<VkDescriptorUpdateTemplateEntry> &entries)
+    : _device{device} {
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    templateInfo.pDescriptorUpdateEntries = entries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = setLayout.getDescriptorSetLayout();
+
+    if (vkCreateDescriptorUpdateTemplate(device.getVkDevice(), &templateInfo, nullptr, &_updateTemplate) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor update template!");
+    }
+}
+
+DescriptorUpdateTemplate::~DescriptorUpdateTemplate() {
+    vkDestroyDescriptorUpdateTemplate(_device.getVkDevice(), _updateTemplate, nullptr);
+}
+
+void DescriptorUpdateTemplate::update(VkDescriptorSet set, const void *data) const {
+    vkUpdateDescriptorSetWithTemplate(_device.getVkDevice(), set, _updateTemplate, data);
+}
+
 // *************** Descriptor Writer *********************
 
 DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool)
     : _setLayout{setLayout}
-    , _pool{pool} {}
+    , _pool{&pool} {}
+
+DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorAllocator &allocator)
+    : _setLayout{setLayout}
+    , _allocator{&allocator} {}
 
 DescriptorWriter &DescriptorWriter::writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo) {
     assert(_setLayout._bindings.count(binding) == 1 && "Layout does not contain specified binding");
@@ -162,7 +440,13 @@ DescriptorWriter &DescriptorWriter::writeImage(uint32_t binding, VkDescriptorIma
 }
 
 bool DescriptorWriter::build(VkDescriptorSet &set) {
-    bool success = _pool.allocateDescriptor(_setLayout.getDescriptorSetLayout(), set);
+    if (_allocator != nullptr) {
+        set = _allocator->allocate(_setLayout);
+        overwrite(set);
+        return true;
+    }
+
+    bool success = _pool->allocateDescriptor(_setLayout.getDescriptorSetLayout(), set);
     if (!success) {
         return false;
     }
@@ -174,6 +458,6 @@ void DescriptorWriter::overwrite(VkDescriptorSet &set) {
     for (auto &write : _writes) {
         write.dstSet = set;
     }
-    vkUpdateDescriptorSets(_pool._device.getVkDevice(), _writes.size(), _writes.data(), 0, nullptr);
+    vkUpdateDescriptorSets(_setLayout._device.getVkDevice(), _writes.size(), _writes.data(), 0, nullptr);
 }
 }
\ No newline at end of file
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
 #include "Device.h"
 
 namespace vge {
+class DescriptorLayoutCache;
+
 class DescriptorSetLayout {
 public:
     class Builder {
@@ -19,6 +22,8 @@ public:
                             VkShaderStageFlags stageFlags,
                             uint32_t count = 1);
         std::unique_ptr<DescriptorSetLayout> build() const;
+        // Shares the layout with every other build of the same bindings
+        std::shared_ptr<DescriptorSetLayout> build(DescriptorLayoutCache &cache) const;
 
     private:
         Device &_device;
@@ -39,6 +44,81 @@ private:
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> _bindings;
 
     friend class DescriptorWriter;
+    friend class DescriptorUpdateTemplate;
+};
+
+// Hands out one DescriptorSetLayout per distinct set of bindings, so systems describing the same set share a
+// layout instead of each creating their own. Safe to use from several threads.
+class DescriptorLayoutCache {
+public:
+    explicit DescriptorLayoutCache(Device &device)
+        : _device{device} {}
+
+    DescriptorLayoutCache(const DescriptorLayoutCache &) = delete;
+    DescriptorLayoutCache &operator=(const DescriptorLayoutCache &) = delete;
+
+    std::shared_ptr<DescriptorSetLayout> getLayout(
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings);
+
+    size_t getLayoutCount();
+    uint32_t getHitCount();
+
+private:
+    // The bindings ordered by binding number
+    struct Signature {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+        bool operator==(const Signature &other) const;
+    };
+
+    struct SignatureHash {
+        size_t operator()(const Signature &signature) const;
+    };
+
+    Device &_device;
+    std::mutex _mutex;
+    std::unordered_map<Signature, std::shared_ptr<DescriptorSetLayout>, SignatureHash> _layouts;
+    uint32_t _hits = 0;
+};
+
+// Hands out one VkPipelineLayout per distinct list of set layouts and push constant ranges, and destroys
+// them along with the cache. The set layouts must come from a DescriptorLayoutCache that outlives this one:
+// it has a single layout per binding signature and keeps them all, so equal handles mean equal sets. That
+// makes a layout handed out here stand for its content, pipelines can be keyed on it. Safe to use from
+// several threads.
+class PipelineLayoutCache {
+public:
+    explicit PipelineLayoutCache(Device &device)
+        : _device{device} {}
+    ~PipelineLayoutCache();
+
+    PipelineLayoutCache(const PipelineLayoutCache &) = delete;
+    PipelineLayoutCache &operator=(const PipelineLayoutCache &) = delete;
+
+    VkPipelineLayout getLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                               const std::vector<VkPushConstantRange> &pushConstantRanges = {});
+
+    // Whether layout was handed out by this cache
+    bool contains(VkPipelineLayout layout);
+    size_t getLayoutCount();
+    uint32_t getHitCount();
+
+private:
+    struct Signature {
+        std::vector<VkDescriptorSetLayout> setLayouts;
+        std::vector<VkPushConstantRange> pushConstantRanges;
+
+        bool operator==(const Signature &other) const;
+    };
+
+    struct SignatureHash {
+        size_t operator()(const Signature &signature) const;
+    };
+
+    Device &_device;
+    std::mutex _mutex;
+    std::unordered_map<Signature, VkPipelineLayout, SignatureHash> _layouts;
+    uint32_t _hits = 0;
 };
 
 class DescriptorPool {
@@ -82,9 +162,85 @@ private:
     friend class DescriptorWriter;
 };
 
+// Allocates sets from a chain of pools, creating a larger one whenever the last runs out. Sets are never
+// freed one by one, reset recycles them all at once and keeps the pools. Pools are sized per set, by how many
+// descriptors of each type an average set holds.
+class DescriptorAllocator {
+public:
+    struct PoolSizeRatio {
+        VkDescriptorType descriptorType;
+        float descriptorsPerSet;
+    };
+
+    // Each new pool holds twice the sets of the one before, up to this many
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    DescriptorAllocator(Device &device,
+                        uint32_t initialSetsPerPool,
+                        std::vector<PoolSizeRatio> poolSizeRatios);
+    ~DescriptorAllocator();
+    DescriptorAllocator(const DescriptorAllocator &) = delete;
+    DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+    VkDescriptorSet allocate(const DescriptorSetLayout &setLayout);
+    // Invalidates every set allocated so far. No command buffer using them may be pending.
+    void reset();
+
+    inline size_t getPoolCount() const { return _readyPools.size() + _fullPools.size(); }
+
+private:
+    // One with room left, created if there is none
+    VkDescriptorPool getPool();
+
+private:
+    Device &_device;
+    std::vector<PoolSizeRatio> _poolSizeRatios;
+    uint32_t _setsPerPool;
+    // Allocation tries the last one first
+    std::vector<VkDescriptorPool> _readyPools;
+    std::vector<VkDescriptorPool> _fullPools;
+};
+
+// Rewrites a whole set from one struct in a single call. The driver reads each binding's descriptor info at
+// its offset in the struct, with none of the per-binding VkWriteDescriptorSet setup, which suits sets
+// rebuilt every frame.
+class DescriptorUpdateTemplate {
+public:
+    class Builder {
+    public:
+        Builder(Device &device, const DescriptorSetLayout &setLayout)
+            : _device{device}
+            , _setLayout{setLayout} {}
+
+        // offset locates the binding's VkDescriptorBufferInfo or VkDescriptorImageInfo in the update data. An
+        // array binding reads its elements stride bytes apart, the info's size if stride is 0.
+        Builder& addEntry(uint32_t binding, size_t offset, size_t stride = 0);
+        std::unique_ptr<DescriptorUpdateTemplate> build() const;
+
+    private:
+        Device &_device;
+        const DescriptorSetLayout &_setLayout;
+        std::vector<VkDescriptorUpdateTemplateEntry> _entries{};
+    };
+
+    DescriptorUpdateTemplate(Device &device,
+                             const DescriptorSetLayout &setLayout,
+                             const std::vector<VkDescriptorUpdateTemplateEntry> &entries);
+    ~DescriptorUpdateTemplate();
+    DescriptorUpdateTemplate(const DescriptorUpdateTemplate &) = delete;
+    DescriptorUpdateTemplate &operator=(const DescriptorUpdateTemplate &) = delete;
+
+    void update(VkDescriptorSet set, const void *data) const;
+
+private:
+    Device &_device;
+    VkDescriptorUpdateTemplate _updateTemplate;
+};
+
 class DescriptorWriter {
 public:
     DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool);
+    DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorAllocator &allocator);
 
     DescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
     DescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
@@ -94,7 +250,9 @@ public:
 
 private:
     DescriptorSetLayout& _setLayout;
-    DescriptorPool& _pool;
+    // Exactly one of them is set
+    DescriptorPool* _pool = nullptr;
+    DescriptorAllocator* _allocator = nullptr;
     std::vector<VkWriteDescriptorSet> _writes;
 };
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include "Device.h"
 
+#include "Utils.h"
+
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -42,24 +46,40 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance,
 
 // class member functions
 Device::Device(Window &window)
-    : _window{window} {
+    : _window{&window} {
     createInstance();
     setupDebugMessenger();
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
-    createCommandPool();
+    createUploadCommandPool();
+    createPipelineCache();
+}
+
+Device::Device()
+    : _window{nullptr}
+    , _deviceExtensions{} {
+    createInstance();
+    setupDebugMessenger();
+    pickPhysicalDevice();
+    createLogicalDevice();
+    createUploadCommandPool();
+    createPipelineCache();
 }
 
 Device::~Device() {
-    vkDestroyCommandPool(_device, _commandPool, nullptr);
+    savePipelineCache();
+    vkDestroyPipelineCache(_device, _pipelineCache, nullptr);
+    vkDestroyCommandPool(_device, _uploadCommandPool, nullptr);
     vkDestroyDevice(_device, nullptr);
 
     if (enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(_instance, _debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    if (_surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    }
     vkDestroyInstance(_instance, nullptr);
 }
 
@@ -74,7 +94,8 @@ void Device::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // Descriptor update templates are core from 1.1 on
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -132,7 +153,10 @@ void Device::createLogicalDevice() {
     QueueFamilyIndices indices = findQueueFamilies(_physicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value()};
+    if (indices.presentFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.presentFamily.value());
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -144,8 +168,15 @@ void Device::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    // Software implementations used for headless runs may not support anisotropic filtering or
+    // multi-draw-indirect, so everything optional is enabled only where available
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -169,31 +200,126 @@ void Device::createLogicalDevice() {
     if (vkCreateDevice(_physicalDevice, &createInfo, nullptr, &_device) != VK_SUCCESS) {
         throw std::runtime_error("failed to create logical device!");
     }
+    _enabledFeatures = deviceFeatures;
 
     vkGetDeviceQueue(_device, indices.graphicsFamily.value(), 0, &_graphicsQueue);
-    vkGetDeviceQueue(_device, indices.presentFamily.value(), 0, &_presentQueue);
+    if (indices.presentFamily.has_value()) {
+        vkGetDeviceQueue(_device, indices.presentFamily.value(), 0, &_presentQueue);
+    }
 }
 
-void Device::createCommandPool() {
+VkCommandPool Device::createCommandPool(VkCommandPoolCreateFlags flags) {
     QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
 
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.flags = flags;
 
-    if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool) != VK_SUCCESS) {
+    VkCommandPool commandPool;
+    if (vkCreateCommandPool(_device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+    return commandPool;
+}
+
+void Device::createUploadCommandPool() {
+    // Upload command buffers are freed right after use, so they never need individual resets
+    _uploadCommandPool = createCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+}
+
+void Device::createPipelineCache() {
+    std::vector<char> data;
+    if (std::filesystem::exists(PIPELINE_CACHE_PATH)) {
+        data = Utils::readFile(PIPELINE_CACHE_PATH);
+    }
+
+    if (!data.empty() && !isPipelineCacheCompatible(data)) {
+        std::cout << "Pipeline cache " << PIPELINE_CACHE_PATH
+                  << " was written by another device or driver, ignoring it" << std::endl;
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(_device, &createInfo, nullptr, &_pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    _isPipelineCacheWarm = !data.empty();
+    std::cout << "Pipeline cache: " << (_isPipelineCacheWarm ? "warm, " : "cold, ") << data.size()
+              << " bytes loaded" << std::endl;
+}
+
+bool Device::isPipelineCacheCompatible(const std::vector<char> &data) const {
+    // Layout of VkPipelineCacheHeaderVersionOne, read with memcpy since the blob has no alignment guarantees
+    const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (data.size() < headerSize) {
+        return false;
+    }
+
+    uint32_t header[4];
+    std::memcpy(header, data.data(), sizeof(header));
+
+    return header[0] >= headerSize && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header[2] == properties.vendorID && header[3] == properties.deviceID &&
+           std::memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void Device::savePipelineCache() {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(_device, _pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        return;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(_device, _pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    // Write to a temporary file and rename it over the old cache, so a crash mid-write never leaves a
+    // truncated cache behind
+    const std::string tempPath = std::string(PIPELINE_CACHE_PATH) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(dataSize));
+        if (!file) {
+            std::cerr << "Unable to write pipeline cache: " << tempPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, PIPELINE_CACHE_PATH, error);
+    if (error) {
+        std::cerr << "Unable to replace pipeline cache: " << error.message() << std::endl;
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+
+    std::cout << "Pipeline cache: " << dataSize << " bytes saved" << std::endl;
 }
 
-void Device::createSurface() { _window.createWindowSurface(_instance, &_surface); }
+void Device::createSurface() { _window->createWindowSurface(_instance, &_surface); }
 
 bool Device::isDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = findQueueFamilies(device);
 
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_1) {
+        return false;
+    }
+
+    if (isHeadless()) {
+        return indices.graphicsFamily.has_value() && extensionsSupported;
+    }
+
     bool swapChainAdequate = false;
     if (extensionsSupported) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
@@ -254,11 +380,15 @@ bool Device::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> Device::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char *> extensions;
 
-    std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    if (!isHeadless()) {
+        uint32_t glfwExtensionCount = 0;
+        const char **glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -317,16 +447,24 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) {
 
     int i = 0;
     for (const auto &queueFamily : queueFamilies) {
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        // The graphics queue also runs the culling compute pass, so it must support both
+        constexpr VkQueueFlags requiredFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+        if (queueFamily.queueCount > 0 && (queueFamily.queueFlags & requiredFlags) == requiredFlags) {
             indices.graphicsFamily = i;
         }
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
-        if (queueFamily.queueCount > 0 && presentSupport) {
-            indices.presentFamily = i;
-        }
-        if (indices.isComplete()) {
-            break;
+        if (isHeadless()) {
+            if (indices.graphicsFamily.has_value()) {
+                break;
+            }
+        } else {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+            if (queueFamily.queueCount > 0 && presentSupport) {
+                indices.presentFamily = i;
+            }
+            if (indices.isComplete()) {
+                break;
+            }
         }
 
         i++;
@@ -422,7 +560,7 @@ VkCommandBuffer Device::beginSingleTimeCommands() {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = _commandPool;
+    allocInfo.commandPool = _uploadCommandPool;
     allocInfo.commandBufferCount = 1;
 
     VkCommandBuffer commandBuffer;
@@ -447,15 +585,19 @@ void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
     vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
     vkQueueWaitIdle(_graphicsQueue);
 
-    vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+    vkFreeCommandBuffers(_device, _uploadCommandPool, 1, &commandBuffer);
 }
 
-void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+void Device::copyBuffer(VkBuffer srcBuffer,
+                        VkBuffer dstBuffer,
+                        VkDeviceSize size,
+                        VkDeviceSize srcOffset,
+                        VkDeviceSize dstOffset) {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
     VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;  // Optional
-    copyRegion.dstOffset = 0;  // Optional
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -497,6 +639,40 @@ void Device::createImageWithInfo(const VkImageCreateInfo &imageInfo,
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(_device, image, &memRequirements);
 
+    allocateImageMemory(image, memRequirements, properties, imageMemory);
+}
+
+void Device::createTransientImage(const VkImageCreateInfo &imageInfo,
+                                  VkImage &image,
+                                  VkDeviceMemory &imageMemory) {
+    if (vkCreateImage(_device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(_device, image, &memRequirements);
+
+    // A lazy memory type only counts if the image can live in it
+    const VkMemoryPropertyFlags lazyProperties =
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memProperties);
+    bool hasLazyMemory = false;
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        hasLazyMemory |= (memRequirements.memoryTypeBits & (1 << i)) &&
+                         (memProperties.memoryTypes[i].propertyFlags & lazyProperties) == lazyProperties;
+    }
+
+    allocateImageMemory(image,
+                        memRequirements,
+                        hasLazyMemory ? lazyProperties : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                        imageMemory);
+}
+
+void Device::allocateImageMemory(VkImage image,
+                                 const VkMemoryRequirements &memRequirements,
+                                 VkMemoryPropertyFlags properties,
+                                 VkDeviceMemory &imageMemory) {
     VkMemoryAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memRequirements.size;
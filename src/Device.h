@@ -28,7 +28,12 @@ public:
     const bool enableValidationLayers = true;
 #endif
 
+    // Relative to the working directory, next to the executable like the shader and model paths
+    static constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
     Device(Window& window);
+    // Headless device: no surface, no present queue and no swap chain extension
+    Device();
     ~Device();
 
     // Not copyable or movable
@@ -37,11 +42,21 @@ public:
     Device(Device&&) = delete;
     Device &operator=(Device&&) = delete;
 
-    inline VkCommandPool getCommandPool() const { return _commandPool; }
     inline VkDevice getVkDevice() const { return _device; }
     inline VkSurfaceKHR getSurface() const { return _surface; }
     inline VkQueue getGraphicsQueue() const { return _graphicsQueue; }
     inline VkQueue getPresentQueue() const { return _presentQueue; }
+    inline bool isHeadless() const { return _window == nullptr; }
+    // Internally synchronized, may be used from several threads at once
+    inline VkPipelineCache getPipelineCache() const { return _pipelineCache; }
+    // True if the cache was primed from disk, i.e. pipeline creation should mostly be cache hits
+    inline bool isPipelineCacheWarm() const { return _isPipelineCacheWarm; }
+    // Optional features actually enabled on the logical device
+    inline const VkPhysicalDeviceFeatures& getEnabledFeatures() const { return _enabledFeatures; }
+    // Multi-draw-indirect with per-command firstInstance, needed for GPU-driven rendering
+    inline bool supportsMultiDrawIndirect() const {
+        return _enabledFeatures.multiDrawIndirect && _enabledFeatures.drawIndirectFirstInstance;
+    }
 
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(_physicalDevice); }
     QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(_physicalDevice); }
@@ -51,6 +66,9 @@ public:
                                  VkImageTiling tiling,
                                  VkFormatFeatureFlags features);
 
+    // Caller owns the returned pool
+    VkCommandPool createCommandPool(VkCommandPoolCreateFlags flags);
+
     // Buffer Helper Functions
     void createBuffer(VkDeviceSize size,
                       VkBufferUsageFlags usage,
@@ -59,7 +77,11 @@ public:
                       VkDeviceMemory &bufferMemory);
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    void copyBuffer(VkBuffer srcBuffer,
+                    VkBuffer dstBuffer,
+                    VkDeviceSize size,
+                    VkDeviceSize srcOffset = 0,
+                    VkDeviceSize dstOffset = 0);
     void copyBufferToImage(VkBuffer buffer,
                            VkImage image,
                            uint32_t _width,
@@ -70,6 +92,11 @@ public:
                              VkMemoryPropertyFlags properties,
                              VkImage &image,
                              VkDeviceMemory &imageMemory);
+    // For attachments with TRANSIENT usage: lazily allocated memory where the device has a type the image
+    // can use, device-local otherwise
+    void createTransientImage(const VkImageCreateInfo &imageInfo,
+                              VkImage &image,
+                              VkDeviceMemory &imageMemory);
 
     VkPhysicalDeviceProperties properties;
 
@@ -79,7 +106,13 @@ private:
     void createSurface();
     void pickPhysicalDevice();
     void createLogicalDevice();
-    void createCommandPool();
+    void createUploadCommandPool();
+    void createPipelineCache();
+    void savePipelineCache();
+    void allocateImageMemory(VkImage image,
+                             const VkMemoryRequirements &memRequirements,
+                             VkMemoryPropertyFlags properties,
+                             VkDeviceMemory &imageMemory);
 
     // helper functions
     bool isDeviceSuitable(VkPhysicalDevice device);
@@ -89,22 +122,27 @@ private:
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool isPipelineCacheCompatible(const std::vector<char> &data) const;
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
 private:
     VkInstance _instance;
     VkDebugUtilsMessengerEXT _debugMessenger;
     VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
-    Window& _window;
-    VkCommandPool _commandPool;
+    Window* _window;
+    // Single-time upload commands only, frames record into the renderer's own pools
+    VkCommandPool _uploadCommandPool;
 
     VkDevice _device;
-    VkSurfaceKHR _surface;
+    VkSurfaceKHR _surface = VK_NULL_HANDLE;
     VkQueue _graphicsQueue;
-    VkQueue _presentQueue;
+    VkQueue _presentQueue = VK_NULL_HANDLE;
+    VkPipelineCache _pipelineCache = VK_NULL_HANDLE;
+    bool _isPipelineCacheWarm = false;
+    VkPhysicalDeviceFeatures _enabledFeatures{};
 
     const std::vector<const char *> _validationLayers = {"VK_LAYER_KHRONOS_validation"};
-    const std::vector<const char *> _deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    std::vector<const char *> _deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
 
 }  // namespace vge
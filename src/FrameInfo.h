@@ -3,15 +3,32 @@
 #include <vulkan/vulkan.h>
 
 #include "Camera.h"
-#include "GameObject.h"
+#include "CommandRecorder.h"
+#include "Descriptor.h"
+#include "Model.h"
+
+#include <vector>
 
 namespace vge {
 
-const int MAX_LIGHTS = 10;
+// Capacity of the point light storage buffer
+const uint32_t MAX_POINT_LIGHTS = 4096;
 
-struct PointLight {
-    glm::vec4 position{};
+// Specialization constant IDs shared by all shaders
+enum ShaderConstantId : uint32_t {
+    SHADER_CONSTANT_SPECULAR_ENABLED = 1,
+    SHADER_CONSTANT_AMBIENT_ONLY = 2,
+};
+
+// Element of the point light storage buffer at global set binding 1, std430
+struct PointLightData {
+    glm::vec3 position{};
+    // Distance at which the light's contribution falls to zero, the extent it is binned into clusters with
+    float range;
     glm::vec4 color{};
+    // Billboard size
+    float radius;
+    uint32_t padding[3];
 };
 
 struct GlobalUbo {
@@ -19,16 +36,47 @@ struct GlobalUbo {
     glm::mat4 view{1.0f};
     glm::mat4 inverseView{1.0f};
     glm::vec4 ambientLightColor{1.0f, 1.0f, 1.0f, 0.2f};
-    PointLight pointLights[MAX_LIGHTS];
-    int numLights;
+};
+
+struct RenderObject {
+    // Models are owned by the game objects, which outlive every snapshot
+    Model* model;
+    glm::mat4 modelMatrix{1.0f};
+    glm::mat4 normalMatrix{1.0f};
+    // Rasterized by software occlusion culling, see OcclusionCuller
+    bool occluder = false;
+};
+
+struct PointLightObject {
+    glm::vec4 position{};
+    glm::vec4 color{};
+    float radius;
+    float range;
+};
+
+// Immutable result of one simulation step. The render thread records from it while the
+// simulation thread is already producing the next one, so it must not point into game objects.
+struct FrameSnapshot {
+    float frameTime = 0.0f;
+    Camera camera{};
+    std::vector<RenderObject> objects;
+    std::vector<PointLightObject> pointLights;
+    // False if nothing visible changed since the previous snapshot
+    bool sceneChanged = true;
 };
 
 struct FrameInfo {
     int frameIndex;
     float frameTime;
     VkCommandBuffer commandBuffer;
-    Camera& camera;
+    // Records into commandBuffer, dropping redundant state changes. Systems record through it.
+    CommandRecorder& recorder;
+    const Camera& camera;
     VkDescriptorSet globalDescriptorSet;
-    GameObject::Map& gameObjects;
+    const FrameSnapshot& snapshot;
+    // Size of the framebuffer rendered into
+    VkExtent2D extent;
+    // Sets that live for this frame only, all recycled once its fence has been waited on
+    DescriptorAllocator& descriptorAllocator;
 };
 }  // namespace vge
\ No newline at end of file
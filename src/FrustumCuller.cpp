@@ -0,0 +1,162 @@
+#include "FrustumCuller.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VGE_CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VGE_CULL_SSE
+#endif
+
+namespace vge {
+
+void FrustumCuller::clear() {
+    for (auto* column : {&_centerX, &_centerY, &_centerZ, &_extentX, &_extentY, &_extentZ}) {
+        column->clear();
+    }
+}
+
+void FrustumCuller::reserve(size_t count) {
+    for (auto* column : {&_centerX, &_centerY, &_centerZ, &_extentX, &_extentY, &_extentZ}) {
+        column->reserve(count);
+    }
+}
+
+void FrustumCuller::add(const Model::BoundingBox& box, const glm::mat4& modelMatrix) {
+    // The enclosing box keeps the transformed center, its extents are the box's axes projected on the
+    // world axes
+    const glm::mat3 absolute{glm::abs(glm::vec3(modelMatrix[0])),
+                             glm::abs(glm::vec3(modelMatrix[1])),
+                             glm::abs(glm::vec3(modelMatrix[2]))};
+    add(glm::vec3(modelMatrix * glm::vec4(box.center(), 1.0f)), absolute * box.extents());
+}
+
+void FrustumCuller::add(const glm::vec3& center, const glm::vec3& extents) {
+    _centerX.push_back(center.x);
+    _centerY.push_back(center.y);
+    _centerZ.push_back(center.z);
+    _extentX.push_back(extents.x);
+    _extentY.push_back(extents.y);
+    _extentZ.push_back(extents.z);
+}
+
+const char* FrustumCuller::simdPath() {
+#if defined(VGE_CULL_AVX)
+    return "AVX";
+#elif defined(VGE_CULL_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+size_t FrustumCuller::cull(const std::array<glm::vec4, 6>& planes, std::vector<uint8_t>& visibility) const {
+    const size_t count = size();
+    visibility.resize(count);
+
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+    // A box is outside a plane when even its corner furthest along the normal is behind it:
+    // dot(n, center) + w + dot(|n|, extents) < 0
+#if defined(VGE_CULL_AVX)
+    __m256 nx[6], ny[6], nz[6], w[6], ax[6], ay[6], az[6];
+    for (size_t p = 0; p < planes.size(); p++) {
+        nx[p] = _mm256_set1_ps(planes[p].x);
+        ny[p] = _mm256_set1_ps(planes[p].y);
+        nz[p] = _mm256_set1_ps(planes[p].z);
+        w[p] = _mm256_set1_ps(planes[p].w);
+        ax[p] = _mm256_set1_ps(glm::abs(planes[p].x));
+        ay[p] = _mm256_set1_ps(glm::abs(planes[p].y));
+        az[p] = _mm256_set1_ps(glm::abs(planes[p].z));
+    }
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (; i + 8 <= count; i += 8) {
+        const __m256 cx = _mm256_loadu_ps(&_centerX[i]);
+        const __m256 cy = _mm256_loadu_ps(&_centerY[i]);
+        const __m256 cz = _mm256_loadu_ps(&_centerZ[i]);
+        const __m256 ex = _mm256_loadu_ps(&_extentX[i]);
+        const __m256 ey = _mm256_loadu_ps(&_extentY[i]);
+        const __m256 ez = _mm256_loadu_ps(&_extentZ[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (size_t p = 0; p < planes.size(); p++) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(nx[p], cx), w[p]);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(ny[p], cy));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(nz[p], cz));
+            __m256 radius = _mm256_mul_ps(ax[p], ex);
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(ay[p], ey));
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(az[p], ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+        }
+
+        const int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; lane++) {
+            const uint8_t visible = (mask >> lane) & 1;
+            visibility[i + lane] = visible;
+            visibleCount += visible;
+        }
+    }
+#elif defined(VGE_CULL_SSE)
+    __m128 nx[6], ny[6], nz[6], w[6], ax[6], ay[6], az[6];
+    for (size_t p = 0; p < planes.size(); p++) {
+        nx[p] = _mm_set1_ps(planes[p].x);
+        ny[p] = _mm_set1_ps(planes[p].y);
+        nz[p] = _mm_set1_ps(planes[p].z);
+        w[p] = _mm_set1_ps(planes[p].w);
+        ax[p] = _mm_set1_ps(glm::abs(planes[p].x));
+        ay[p] = _mm_set1_ps(glm::abs(planes[p].y));
+        az[p] = _mm_set1_ps(glm::abs(planes[p].z));
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128 cx = _mm_loadu_ps(&_centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&_centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&_centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&_extentX[i]);
+        const __m128 ey = _mm_loadu_ps(&_extentY[i]);
+        const __m128 ez = _mm_loadu_ps(&_extentZ[i]);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t p = 0; p < planes.size(); p++) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(nx[p], cx), w[p]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(ny[p], cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(nz[p], cz));
+            __m128 radius = _mm_mul_ps(ax[p], ex);
+            radius = _mm_add_ps(radius, _mm_mul_ps(ay[p], ey));
+            radius = _mm_add_ps(radius, _mm_mul_ps(az[p], ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++) {
+            const uint8_t visible = (mask >> lane) & 1;
+            visibility[i + lane] = visible;
+            visibleCount += visible;
+        }
+    }
+#endif
+
+    // Remainder, or everything without SIMD
+    for (; i < count; i++) {
+        bool visible = true;
+        for (const auto& plane : planes) {
+            const float distance =
+                plane.x * _centerX[i] + plane.y * _centerY[i] + plane.z * _centerZ[i] + plane.w;
+            const float radius = glm::abs(plane.x) * _extentX[i] + glm::abs(plane.y) * _extentY[i] +
+                                 glm::abs(plane.z) * _extentZ[i];
+            if (distance + radius < 0.0f) {
+                visible = false;
+                break;
+            }
+        }
+        visibility[i] = visible ? 1 : 0;
+        visibleCount += visible ? 1 : 0;
+    }
+
+    return visibleCount;
+}
+
+}  // namespace vge
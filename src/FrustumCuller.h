@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Model.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace vge {
+
+// Tests the world-space bounding boxes of many objects against the six frustum planes per call. The boxes
+// are stored as a structure of arrays so a SIMD register holds one coordinate of 8 (AVX) or 4 (SSE)
+// objects, and each plane costs a handful of multiply-adds per register.
+class FrustumCuller {
+public:
+    void clear();
+    void reserve(size_t count);
+
+    // Adds the world-space box enclosing a model-space box transformed by modelMatrix
+    void add(const Model::BoundingBox& box, const glm::mat4& modelMatrix);
+    void add(const glm::vec3& center, const glm::vec3& extents);
+
+    inline size_t size() const { return _centerX.size(); }
+
+    // Sets visibility[i] to 1 if box i intersects or lies inside the frustum and to 0 otherwise, and returns
+    // the number of visible boxes. Planes are as returned by Camera::getFrustumPlanes.
+    size_t cull(const std::array<glm::vec4, 6>& planes, std::vector<uint8_t>& visibility) const;
+
+    // Name of the compiled-in path: "AVX", "SSE" or "scalar"
+    static const char* simdPath();
+
+private:
+    std::vector<float> _centerX;
+    std::vector<float> _centerY;
+    std::vector<float> _centerZ;
+    std::vector<float> _extentX;
+    std::vector<float> _extentY;
+    std::vector<float> _extentZ;
+};
+
+}  // namespace vge
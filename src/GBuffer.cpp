@@ -0,0 +1,200 @@
+#include "GBuffer.h"
+
+#include <array>
+#include <stdexcept>
+
+namespace vge {
+
+VkRenderPass GBuffer::createRenderPass(Device& device,
+                                       VkFormat colorFormat,
+                                       VkImageLayout colorFinalLayout,
+                                       VkFormat depthFormat,
+                                       RenderPassSignature& signature) {
+    std::array<VkAttachmentDescription, ATTACHMENT_COUNT> attachments{};
+    for (auto& attachment : attachments) {
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    attachments[COLOR_ATTACHMENT].format = colorFormat;
+    attachments[COLOR_ATTACHMENT].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[COLOR_ATTACHMENT].finalLayout = colorFinalLayout;
+    attachments[DEPTH_ATTACHMENT].format = depthFormat;
+    attachments[DEPTH_ATTACHMENT].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    attachments[ALBEDO_ATTACHMENT].format = ALBEDO_FORMAT;
+    attachments[ALBEDO_ATTACHMENT].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    attachments[NORMAL_ATTACHMENT].format = NORMAL_FORMAT;
+    attachments[NORMAL_ATTACHMENT].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    std::array<VkAttachmentReference, GEOMETRY_COLOR_ATTACHMENT_COUNT> geometryColorRefs{{
+        {ALBEDO_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+        {NORMAL_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+    }};
+    VkAttachmentReference geometryDepthRef{DEPTH_ATTACHMENT,
+                                           VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    // Depth stays bound read-only during lighting, so the light volumes and billboards are still depth tested
+    VkAttachmentReference lightingColorRef{COLOR_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference lightingDepthRef{DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    // Input attachment indices as seen by the lighting shaders: albedo, normal, depth
+    std::array<VkAttachmentReference, 3> lightingInputRefs{{
+        {ALBEDO_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {NORMAL_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+    }};
+
+    std::array<VkSubpassDescription, 2> subpasses{};
+    subpasses[GEOMETRY_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[GEOMETRY_SUBPASS].colorAttachmentCount = static_cast<uint32_t>(geometryColorRefs.size());
+    subpasses[GEOMETRY_SUBPASS].pColorAttachments = geometryColorRefs.data();
+    subpasses[GEOMETRY_SUBPASS].pDepthStencilAttachment = &geometryDepthRef;
+
+    subpasses[LIGHTING_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[LIGHTING_SUBPASS].colorAttachmentCount = 1;
+    subpasses[LIGHTING_SUBPASS].pColorAttachments = &lightingColorRef;
+    subpasses[LIGHTING_SUBPASS].pDepthStencilAttachment = &lightingDepthRef;
+    subpasses[LIGHTING_SUBPASS].inputAttachmentCount = static_cast<uint32_t>(lightingInputRefs.size());
+    subpasses[LIGHTING_SUBPASS].pInputAttachments = lightingInputRefs.data();
+
+    std::vector<VkSubpassDependency> dependencies(3);
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = GEOMETRY_SUBPASS;
+    dependencies[0].srcStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask =
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // The color attachment is first used by the lighting subpass, its layout transition has to wait for the
+    // acquired image as well
+    dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].dstSubpass = LIGHTING_SUBPASS;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = 0;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    // Each pixel only reads the G-buffer texel it covers, which lets a tiler keep the whole pass on chip
+    dependencies[2].srcSubpass = GEOMETRY_SUBPASS;
+    dependencies[2].dstSubpass = LIGHTING_SUBPASS;
+    dependencies[2].srcStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[2].srcAccessMask =
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[2].dstStageMask =
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[2].dstAccessMask =
+        VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    if (colorFinalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        VkSubpassDependency readback{};
+        readback.srcSubpass = LIGHTING_SUBPASS;
+        readback.dstSubpass = VK_SUBPASS_EXTERNAL;
+        readback.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        readback.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        readback.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        readback.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        dependencies.push_back(readback);
+    }
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+    renderPassInfo.pSubpasses = subpasses.data();
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+    signature = RenderPassSignature::fromCreateInfo(renderPassInfo);
+
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(device.getVkDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create deferred render pass!");
+    }
+    return renderPass;
+}
+
+GBuffer::GBuffer(Device& device, VkExtent2D extent, VkFormat depthFormat, size_t count)
+    : _device{device}
+    , _extent{extent}
+    , _attachments(count) {
+    const VkImageUsageFlags inputUsage =
+        VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+    for (auto& attachments : _attachments) {
+        createAttachment(depthFormat,
+                         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | inputUsage,
+                         VK_IMAGE_ASPECT_DEPTH_BIT,
+                         attachments.depth);
+        createAttachment(ALBEDO_FORMAT,
+                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | inputUsage,
+                         VK_IMAGE_ASPECT_COLOR_BIT,
+                         attachments.albedo);
+        createAttachment(NORMAL_FORMAT,
+                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | inputUsage,
+                         VK_IMAGE_ASPECT_COLOR_BIT,
+                         attachments.normal);
+    }
+}
+
+GBuffer::~GBuffer() {
+    for (size_t i = 0; i < _images.size(); i++) {
+        vkDestroyImageView(_device.getVkDevice(), _imageViews[i], nullptr);
+        vkDestroyImage(_device.getVkDevice(), _images[i], nullptr);
+        vkFreeMemory(_device.getVkDevice(), _imageMemorys[i], nullptr);
+    }
+}
+
+void GBuffer::createAttachment(VkFormat format,
+                               VkImageUsageFlags usage,
+                               VkImageAspectFlags aspect,
+                               VkImageView& view) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = _extent.width;
+    imageInfo.extent.height = _extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.flags = 0;
+
+    VkImage image;
+    VkDeviceMemory imageMemory;
+    _device.createTransientImage(imageInfo, image, imageMemory);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = aspect;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(_device.getVkDevice(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+        vkDestroyImage(_device.getVkDevice(), image, nullptr);
+        vkFreeMemory(_device.getVkDevice(), imageMemory, nullptr);
+        throw std::runtime_error("failed to create G-buffer image view!");
+    }
+
+    _images.push_back(image);
+    _imageMemorys.push_back(imageMemory);
+    _imageViews.push_back(view);
+}
+}  // namespace vge
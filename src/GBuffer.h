@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Device.h"
+#include "RenderPassSignature.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace vge {
+
+// Attachments of the deferred shading path, one set per framebuffer. Depth, albedo and normals are only
+// ever read as input attachments within the render pass, so they are transient and lazily allocated
+// where the device supports it: a tiler keeps them on chip and never backs them with memory.
+class GBuffer {
+public:
+    static constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+    // World-space normals, signed
+    static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    // Attachment indices of the deferred render pass. The color attachment keeps index 0 and depth
+    // index 1, like in the forward pass.
+    static constexpr uint32_t COLOR_ATTACHMENT = 0;
+    static constexpr uint32_t DEPTH_ATTACHMENT = 1;
+    static constexpr uint32_t ALBEDO_ATTACHMENT = 2;
+    static constexpr uint32_t NORMAL_ATTACHMENT = 3;
+    static constexpr uint32_t ATTACHMENT_COUNT = 4;
+
+    // Subpass 0 writes the G-buffer, subpass 1 reads it and accumulates lighting into the color attachment
+    static constexpr uint32_t GEOMETRY_SUBPASS = 0;
+    static constexpr uint32_t LIGHTING_SUBPASS = 1;
+    static constexpr uint32_t GEOMETRY_COLOR_ATTACHMENT_COUNT = 2;
+
+    struct Attachments {
+        VkImageView depth;
+        VkImageView albedo;
+        VkImageView normal;
+    };
+
+    // A colorFinalLayout of TRANSFER_SRC_OPTIMAL also makes the lighting output visible to a copy
+    // recorded after the render pass. The pass' signature is returned in signature.
+    static VkRenderPass createRenderPass(Device &device,
+                                         VkFormat colorFormat,
+                                         VkImageLayout colorFinalLayout,
+                                         VkFormat depthFormat,
+                                         RenderPassSignature &signature);
+
+    GBuffer(Device &device, VkExtent2D extent, VkFormat depthFormat, size_t count);
+    ~GBuffer();
+
+    GBuffer(const GBuffer &) = delete;
+    GBuffer &operator=(const GBuffer &) = delete;
+
+    inline const Attachments &getAttachments(size_t index) const { return _attachments[index]; }
+
+private:
+    void createAttachment(VkFormat format,
+                          VkImageUsageFlags usage,
+                          VkImageAspectFlags aspect,
+                          VkImageView &view);
+
+private:
+    Device &_device;
+    VkExtent2D _extent;
+
+    std::vector<VkImage> _images;
+    std::vector<VkDeviceMemory> _imageMemorys;
+    std::vector<VkImageView> _imageViews;
+    std::vector<Attachments> _attachments;
+};
+}  // namespace vge
@@ -13,12 +13,17 @@ struct TransformComponent {
     glm::vec3 scale{1.f, 1.f, 1.f};
     glm::vec3 rotation{};
 
+    // Whoever modifies the transform sets this, the application clears it once the change is rendered
+    bool dirty{true};
+
     glm::mat4 mat4() const;
     glm::mat3 normalMatrix() const;
 };
 
 struct PointLightComponent {
     float lightIntensity = 1.0f;
+    // The light has no effect past this distance
+    float range = 5.0f;
 };
 
 class GameObject {
@@ -39,6 +44,9 @@ public:
     std::shared_ptr<Model> model{};
     glm::vec3 color{};
     TransformComponent transform{};
+    // Large, convex objects whose model's occluder mesh hides what lies behind them from software occlusion
+    // culling. A concave model's occluder mesh can hide objects that are visible.
+    bool occluder{false};
 
     std::unique_ptr<PointLightComponent> pointLight = nullptr;
 
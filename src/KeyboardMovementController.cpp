@@ -1,17 +1,18 @@
 #include "KeyboardMovementController.h"
 
 namespace vge {
-void KeyBoardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, GameObject& gameObject) {
+void KeyBoardMovementController::moveInPlaneXZ(const InputState& input, float dt, GameObject& gameObject) {
     glm::vec3 rotate{0.0f};
 
-    if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) rotate.y += 1.0f;
-    if (glfwGetKey(window, keys.lookLeft) == GLFW_PRESS) rotate.y -= 1.0f;
+    if (input.isPressed(keys.lookRight)) rotate.y += 1.0f;
+    if (input.isPressed(keys.lookLeft)) rotate.y -= 1.0f;
 
-    if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) rotate.x += 1.0f;
-    if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.0f;
+    if (input.isPressed(keys.lookUp)) rotate.x += 1.0f;
+    if (input.isPressed(keys.lookDown)) rotate.x -= 1.0f;
 
     if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon()) {
         gameObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+        gameObject.transform.dirty = true;
     }
 
     gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
@@ -24,17 +25,18 @@ void KeyBoardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, Gam
 
 
     glm::vec3 moveDir{0.0f};
-    if (glfwGetKey(window, keys.moveForward) == GLFW_PRESS) moveDir += forwardDir;
-    if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) moveDir -= forwardDir;
+    if (input.isPressed(keys.moveForward)) moveDir += forwardDir;
+    if (input.isPressed(keys.moveBackward)) moveDir -= forwardDir;
 
-    if (glfwGetKey(window, keys.moveRight) == GLFW_PRESS) moveDir += rightDir;
-    if (glfwGetKey(window, keys.moveLeft) == GLFW_PRESS) moveDir -= rightDir;
+    if (input.isPressed(keys.moveRight)) moveDir += rightDir;
+    if (input.isPressed(keys.moveLeft)) moveDir -= rightDir;
 
-    if (glfwGetKey(window, keys.moveUp) == GLFW_PRESS) moveDir += upDir;
-    if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
+    if (input.isPressed(keys.moveUp)) moveDir += upDir;
+    if (input.isPressed(keys.moveDown)) moveDir -= upDir;
 
     if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
         gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+        gameObject.transform.dirty = true;
     }
 }
 }  // namespace vge
\ No newline at end of file
@@ -19,7 +19,7 @@ public:
         int lookDown = GLFW_KEY_DOWN;
     };
 
-    void moveInPlaneXZ(GLFWwindow* window, float dt, GameObject& gameObject);
+    void moveInPlaneXZ(const InputState& input, float dt, GameObject& gameObject);
 
     KeyMappings keys{};
     float moveSpeed{3.0f};
@@ -0,0 +1,82 @@
+#include "MeshPool.h"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace vge {
+
+MeshPool::MeshPool(Device& device, const std::vector<Model*>& models)
+    : _device{device} {
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    std::vector<const Model*> uniqueModels;
+    for (const Model* model : models) {
+        if (_ranges.count(model) != 0) {
+            continue;
+        }
+        if (!model->_hasIndexBuffer) {
+            throw std::runtime_error("failed to add model to mesh pool: it has no index buffer!");
+        }
+
+        _ranges[model] = {indexCount, model->_indexCount, static_cast<int32_t>(vertexCount)};
+        uniqueModels.push_back(model);
+        vertexCount += model->_vertexCount;
+        indexCount += model->_indexCount;
+    }
+
+    if (uniqueModels.empty()) {
+        return;
+    }
+
+    auto createBuffer = [this](VkDeviceSize elementSize, uint32_t count, VkBufferUsageFlags usage) {
+        return std::make_unique<Buffer>(_device,
+                                        elementSize,
+                                        count,
+                                        usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    };
+    const VkBufferUsageFlags vertexUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    _vertexBuffer = createBuffer(sizeof(Model::Vertex), vertexCount, vertexUsage);
+    _positionBuffer = createBuffer(sizeof(Model::PositionVertex), vertexCount, vertexUsage);
+    _indexBuffer = createBuffer(sizeof(uint32_t), indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+    // The models already live on the GPU, so everything is a device-side copy recorded in one go
+    VkCommandBuffer commandBuffer = _device.beginSingleTimeCommands();
+    auto copy = [commandBuffer](const Buffer& src, const Buffer& dst, uint32_t firstElement, uint32_t count) {
+        VkBufferCopy region{};
+        region.srcOffset = 0;
+        region.dstOffset = firstElement * dst.getInstanceSize();
+        region.size = count * dst.getInstanceSize();
+        vkCmdCopyBuffer(commandBuffer, src.getBuffer(), dst.getBuffer(), 1, &region);
+    };
+
+    for (const Model* model : uniqueModels) {
+        const MeshRange& range = _ranges[model];
+        const auto firstVertex = static_cast<uint32_t>(range.vertexOffset);
+
+        copy(*model->_vertexBuffer, *_vertexBuffer, firstVertex, model->_vertexCount);
+        copy(*model->_positionBuffer, *_positionBuffer, firstVertex, model->_vertexCount);
+        copy(*model->_indexBuffer, *_indexBuffer, range.firstIndex, range.indexCount);
+    }
+    _device.endSingleTimeCommands(commandBuffer);
+
+    std::cout << "Mesh pool: " << uniqueModels.size() << " meshes, " << vertexCount << " vertices, "
+              << indexCount << " indices\n";
+}
+
+const MeshPool::MeshRange& MeshPool::getRange(const Model* model) const {
+    auto it = _ranges.find(model);
+    if (it == _ranges.end()) {
+        throw std::runtime_error("failed to find model in mesh pool!");
+    }
+    return it->second;
+}
+
+void MeshPool::bind(CommandRecorder& recorder, bool positionsOnly) const {
+    VkBuffer buffers[] = {positionsOnly ? _positionBuffer->getBuffer() : _vertexBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    recorder.bindVertexBuffers(0, 1, buffers, offsets);
+    recorder.bindIndexBuffer(_indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+}  // namespace vge
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Buffer.h"
+#include "CommandRecorder.h"
+#include "Device.h"
+#include "Model.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vge {
+
+// Every model's geometry packed into shared vertex, position and index buffers. With one binding for
+// all meshes, any number of them can be drawn by a single indirect draw.
+class MeshPool {
+public:
+    // Where a model lives in the shared buffers, in the terms of VkDrawIndexedIndirectCommand
+    struct MeshRange {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+    };
+
+    MeshPool(Device& device, const std::vector<Model*>& models);
+
+    MeshPool(const MeshPool&) = delete;
+    MeshPool& operator=(const MeshPool&) = delete;
+
+    const MeshRange& getRange(const Model* model) const;
+
+    // Binds the full or the position-only vertex stream plus the index buffer
+    void bind(CommandRecorder& recorder, bool positionsOnly) const;
+
+private:
+    Device& _device;
+
+    std::unique_ptr<Buffer> _vertexBuffer;
+    std::unique_ptr<Buffer> _positionBuffer;
+    std::unique_ptr<Buffer> _indexBuffer;
+    std::unordered_map<const Model*, MeshRange> _ranges;
+};
+
+}  // namespace vge
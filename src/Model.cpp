@@ -27,9 +27,17 @@ struct hash<vge::Model::Vertex> {
 
 namespace vge {
 
+// Both layouts are built entirely at compile time
+static_assert(Model::Vertex::layout().attributes[3].offset == offsetof(Model::Vertex, uv));
+static_assert(Model::PositionVertex::layout().binding().stride == sizeof(glm::vec3));
+
 Model::Model(Device& device, const Builder& builder)
-    : _device{device} {
+    : _device{device}
+    , _boundingBox{builder.computeBoundingBox()}
+    , _boundingSphere{builder.computeBoundingSphere()}
+    , _occluderMesh{builder.buildOccluderMesh()} {
     createVertexBuffers(builder.vertices);
+    createPositionBuffer(builder.vertices);
     createIndexBuffers(builder.indices);
 }
 
@@ -58,12 +66,43 @@ void Model::createVertexBuffers(const std::vector<Vertex> &vertices) {
         std::make_unique<Buffer>(_device,
                                  vertexSize,
                                  _vertexCount,
-                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     _device.copyBuffer(stagingBuffer.getBuffer(), _vertexBuffer->getBuffer(), bufferSize);
 }
 
+void Model::createPositionBuffer(const std::vector<Vertex> &vertices) {
+    std::vector<PositionVertex> positions;
+    positions.reserve(vertices.size());
+    for (const auto& vertex : vertices) {
+        positions.push_back({vertex.position});
+    }
+
+    uint32_t positionSize = sizeof(positions[0]);
+    VkDeviceSize bufferSize = sizeof(positions[0]) * _vertexCount;
+
+    Buffer stagingBuffer{_device,
+                         positionSize,
+                         _vertexCount,
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+
+    stagingBuffer.map();
+    stagingBuffer.writeToBuffer((void*)positions.data());
+
+    _positionBuffer =
+        std::make_unique<Buffer>(_device,
+                                 positionSize,
+                                 _vertexCount,
+                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    _device.copyBuffer(stagingBuffer.getBuffer(), _positionBuffer->getBuffer(), bufferSize);
+}
+
 void Model::createIndexBuffers(const std::vector<uint32_t>& indices) {
     _indexCount = static_cast<uint32_t>(indices.size());
     _hasIndexBuffer = !indices.empty();
@@ -88,15 +127,16 @@ void Model::createIndexBuffers(const std::vector<uint32_t>& indices) {
         std::make_unique<Buffer>(_device,
                                  indexSize,
                                  _indexCount,
-                                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     _device.copyBuffer(stagingBuffer.getBuffer(), _indexBuffer->getBuffer(), bufferSize);
 }
 
-void Model::draw(VkCommandBuffer commandBuffer) { 
-    _hasIndexBuffer ? vkCmdDrawIndexed(commandBuffer, _indexCount, 1, 0, 0, 0)
-                    : vkCmdDraw(commandBuffer, _vertexCount, 1, 0, 0);
+void Model::draw(CommandRecorder& recorder, uint32_t instanceCount, uint32_t firstInstance) {
+    _hasIndexBuffer ? recorder.drawIndexed(_indexCount, instanceCount, 0, 0, firstInstance)
+                    : recorder.draw(_vertexCount, instanceCount, 0, firstInstance);
 }
 
 std::unique_ptr<Model> Model::createModelFromFile(Device& device, const std::string_view& path) {
@@ -114,33 +154,24 @@ std::unique_ptr<Model> Model::createModelFromFile(Device& device, const std::str
     return std::make_unique<Model>(device, builder);
 }
 
-void Model::bind(VkCommandBuffer commandBuffer) {
+void Model::bind(CommandRecorder& recorder) {
     VkBuffer buffers[] = {_vertexBuffer->getBuffer()};
     VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    recorder.bindVertexBuffers(0, 1, buffers, offsets);
 
     if (_hasIndexBuffer) {
-        vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        recorder.bindIndexBuffer(_indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
     }
 }
 
-std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
-    std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-    bindingDescriptions[0].binding = 0;
-    bindingDescriptions[0].stride = sizeof(Vertex);
-    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    return bindingDescriptions;
-}
-
-std::vector<VkVertexInputAttributeDescription> Model::Vertex::getAttributeDescriptions() {
-    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
-
-    attributeDescriptions.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)});
-    attributeDescriptions.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)});
-    attributeDescriptions.push_back({2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)});
-    attributeDescriptions.push_back({3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv)});
+void Model::bindPositions(CommandRecorder& recorder) {
+    VkBuffer buffers[] = {_positionBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    recorder.bindVertexBuffers(0, 1, buffers, offsets);
 
-    return attributeDescriptions;
+    if (_hasIndexBuffer) {
+        recorder.bindIndexBuffer(_indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
 }
 
 void Model::Builder::loadModel(const std::string_view& path) {
@@ -203,4 +234,77 @@ void Model::Builder::loadModel(const std::string_view& path) {
     }
 }
 
+Model::BoundingBox Model::Builder::computeBoundingBox() const {
+    if (vertices.empty()) {
+        return {};
+    }
+
+    BoundingBox box{vertices[0].position, vertices[0].position};
+    for (const auto& vertex : vertices) {
+        box.min = glm::min(box.min, vertex.position);
+        box.max = glm::max(box.max, vertex.position);
+    }
+    return box;
+}
+
+Model::BoundingSphere Model::Builder::computeBoundingSphere() const {
+    BoundingSphere sphere{computeBoundingBox().center(), 0.0f};
+    for (const auto& vertex : vertices) {
+        sphere.radius = glm::max(sphere.radius, glm::length(vertex.position - sphere.center));
+    }
+    return sphere;
+}
+
+Model::OccluderMesh Model::Builder::buildOccluderMesh(uint32_t gridSize) const {
+    OccluderMesh mesh{};
+    if (vertices.empty() || gridSize == 0) {
+        return mesh;
+    }
+
+    // Flat meshes get a single layer of cells along their flat axis
+    const BoundingBox box = computeBoundingBox();
+    const glm::vec3 cellSize = glm::max((box.max - box.min) / static_cast<float>(gridSize), glm::vec3(1e-6f));
+    const glm::vec3 lastCell{static_cast<float>(gridSize - 1)};
+    auto cellOf = [&](const glm::vec3& position) {
+        const glm::vec3 cell = glm::min(glm::floor((position - box.min) / cellSize), lastCell);
+        return (static_cast<uint32_t>(cell.z) * gridSize + static_cast<uint32_t>(cell.y)) * gridSize +
+               static_cast<uint32_t>(cell.x);
+    };
+
+    // Cell to proxy vertex, accumulating the positions snapped to it
+    std::unordered_map<uint32_t, uint32_t> cellVertices;
+    std::vector<uint32_t> vertexRemap(vertices.size());
+    std::vector<uint32_t> cellCounts;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const auto nextIndex = static_cast<uint32_t>(mesh.positions.size());
+        auto cellVertex = cellVertices.try_emplace(cellOf(vertices[i].position), nextIndex);
+        if (cellVertex.second) {
+            mesh.positions.emplace_back(0.0f);
+            cellCounts.push_back(0);
+        }
+        const uint32_t index = cellVertex.first->second;
+        mesh.positions[index] += vertices[i].position;
+        ++cellCounts[index];
+        vertexRemap[i] = index;
+    }
+    for (size_t i = 0; i < mesh.positions.size(); i++) {
+        mesh.positions[i] /= static_cast<float>(cellCounts[i]);
+    }
+
+    // Without an index buffer every three vertices are a triangle
+    const size_t indexCount = indices.empty() ? vertices.size() : indices.size();
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        uint32_t triangle[3];
+        for (size_t corner = 0; corner < 3; corner++) {
+            const size_t vertex = indices.empty() ? i + corner : indices[i + corner];
+            triangle[corner] = vertexRemap[vertex];
+        }
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+            continue;
+        }
+        mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+    }
+    return mesh;
+}
+
 }  // namespace vge
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "Device.h"
 #include "Buffer.h"
+#include "CommandRecorder.h"
+#include "VertexLayout.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -19,8 +21,12 @@ public:
         glm::vec3 normal{};
         glm::vec2 uv{};
 
-        static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        static constexpr auto layout() {
+            return makeVertexLayout<Vertex>(VGE_VERTEX_ATTRIBUTE(Vertex, position),
+                                            VGE_VERTEX_ATTRIBUTE(Vertex, color),
+                                            VGE_VERTEX_ATTRIBUTE(Vertex, normal),
+                                            VGE_VERTEX_ATTRIBUTE(Vertex, uv));
+        }
 
         bool operator==(const Vertex& other) const {
             return position == other.position && 
@@ -30,13 +36,52 @@ public:
         }
     };
 
+    // Element of the tightly packed stream bound by bindPositions
+    struct PositionVertex {
+        glm::vec3 position{};
+
+        static constexpr auto layout() {
+            return makeVertexLayout<PositionVertex>(VGE_VERTEX_ATTRIBUTE(PositionVertex, position));
+        }
+    };
+
+    // Model-space bounds of the vertex positions, used for culling
+    struct BoundingBox {
+        glm::vec3 min{};
+        glm::vec3 max{};
+
+        inline glm::vec3 center() const { return (min + max) * 0.5f; }
+        inline glm::vec3 extents() const { return (max - min) * 0.5f; }
+    };
+
+    struct BoundingSphere {
+        glm::vec3 center{};
+        float radius = 0.0f;
+    };
+
+    // Low-poly stand-in for the mesh, rasterized by OcclusionCuller when the object is an occluder
+    struct OccluderMesh {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
     struct Builder {
         std::vector<Vertex> vertices{};
         std::vector<uint32_t> indices{};
 
         void loadModel(const std::string_view& path);
+        BoundingBox computeBoundingBox() const;
+        // Centered on the bounding box, so not minimal, but tight enough for elongated meshes
+        BoundingSphere computeBoundingSphere() const;
+        // Simplifies by vertex clustering: every vertex snaps to the mean of its cell in a gridSize^3 grid
+        // over the bounding box, and triangles collapsed by the snapping are dropped. The means lie inside
+        // the mesh only where it is convex: around concavities the proxy covers pixels the mesh doesn't, so
+        // only convex meshes make safe occluders.
+        OccluderMesh buildOccluderMesh(uint32_t gridSize = OCCLUDER_GRID_SIZE) const;
     };
 
+    static constexpr uint32_t OCCLUDER_GRID_SIZE = 8;
+
     Model(Device& device, const Builder& builder);
     ~Model();
 
@@ -45,21 +90,37 @@ public:
 
     static std::unique_ptr<Model> createModelFromFile(Device& device, const std::string_view& path);
 
-    void bind(VkCommandBuffer commandBuffer);
-    void draw(VkCommandBuffer commandBuffer);
+    void bind(CommandRecorder& recorder);
+    // Binds the position-only vertex stream, a third of the bandwidth of the full vertex for depth passes
+    void bindPositions(CommandRecorder& recorder);
+    void draw(CommandRecorder& recorder, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+    inline const BoundingBox& getBoundingBox() const { return _boundingBox; }
+    inline const BoundingSphere& getBoundingSphere() const { return _boundingSphere; }
+    inline const OccluderMesh& getOccluderMesh() const { return _occluderMesh; }
 
 private:
     void createVertexBuffers(const std::vector<Vertex> &vertices);
+    void createPositionBuffer(const std::vector<Vertex> &vertices);
     void createIndexBuffers(const std::vector<uint32_t>& indices);
 
 private:
     Device& _device;
 
     std::unique_ptr<Buffer> _vertexBuffer;
+    std::unique_ptr<Buffer> _positionBuffer;
     uint32_t _vertexCount;
 
     bool _hasIndexBuffer;
     std::unique_ptr<Buffer> _indexBuffer;
     uint32_t _indexCount;
+
+    BoundingBox _boundingBox;
+    BoundingSphere _boundingSphere;
+    // Kept on the CPU, the only vertex data that is
+    OccluderMesh _occluderMesh;
+
+    // Copies the GPU buffers into its shared ones
+    friend class MeshPool;
 };
 }  // namespace vge
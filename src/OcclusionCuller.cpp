@@ -0,0 +1,301 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define VGE_OCCLUSION_AVX2
+#endif
+
+namespace vge {
+
+static_assert(OcclusionCuller::WIDTH % 8 == 0, "Rows are processed 8 pixels at a time");
+static_assert(OcclusionCuller::HEIGHT % OcclusionCuller::BAND_HEIGHT == 0, "Bands must cover the buffer");
+
+OcclusionCuller::OcclusionCuller(size_t threadCount)
+    : _depth(WIDTH * HEIGHT, 1.0f)
+    , _workers{threadCount} {}
+
+OcclusionCuller::~OcclusionCuller() {
+    if (_job.valid()) {
+        _job.wait();
+    }
+}
+
+size_t OcclusionCuller::defaultThreadCount() {
+    const size_t bandCount = HEIGHT / BAND_HEIGHT;
+    const size_t coreCount = std::thread::hardware_concurrency();
+    return std::clamp(coreCount > 2 ? coreCount - 2 : 1, size_t{1}, bandCount);
+}
+
+const char* OcclusionCuller::simdPath() {
+#if defined(VGE_OCCLUSION_AVX2)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+
+void OcclusionCuller::begin(const glm::mat4& projectionView, const std::vector<RenderObject>& objects) {
+    finish();
+    _job = _cullThread.submit([this, projectionView, &objects]() { cull(projectionView, objects); });
+}
+
+bool OcclusionCuller::finish() {
+    if (!_job.valid()) {
+        return false;
+    }
+    _job.get();
+    return true;
+}
+
+template <typename F>
+void OcclusionCuller::parallelFor(uint32_t count, const F& job) {
+    std::vector<std::future<void>> jobs;
+    jobs.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        jobs.push_back(_workers.submit([&job, i]() { job(i); }));
+    }
+    for (auto& result : jobs) {
+        result.get();
+    }
+}
+
+void OcclusionCuller::cull(const glm::mat4& projectionView, const std::vector<RenderObject>& objects) {
+    using Clock = std::chrono::high_resolution_clock;
+    using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+    auto start = Clock::now();
+    _stats = {};
+    setupTriangles(projectionView, objects);
+    parallelFor(HEIGHT / BAND_HEIGHT, [this](uint32_t band) { rasterizeBand(band); });
+    auto rasterized = Clock::now();
+
+    const auto objectCount = static_cast<uint32_t>(objects.size());
+    _visibility.resize(objectCount);
+    parallelFor((objectCount + TEST_BATCH_SIZE - 1) / TEST_BATCH_SIZE, [&](uint32_t batch) {
+        const uint32_t end = std::min((batch + 1) * TEST_BATCH_SIZE, objectCount);
+        for (uint32_t i = batch * TEST_BATCH_SIZE; i < end; i++) {
+            _visibility[i] = testObject(projectionView, objects[i]) ? 1 : 0;
+        }
+    });
+
+    _stats.triangleCount = static_cast<uint32_t>(_triangles.size());
+    _stats.occludedCount = static_cast<uint32_t>(std::count(_visibility.begin(), _visibility.end(), 0));
+    _stats.rasterTime = Milliseconds(rasterized - start).count();
+    _stats.testTime = Milliseconds(Clock::now() - rasterized).count();
+}
+
+void OcclusionCuller::setupTriangles(const glm::mat4& projectionView,
+                                     const std::vector<RenderObject>& objects) {
+    _triangles.clear();
+    for (const auto& object : objects) {
+        if (!object.occluder) {
+            continue;
+        }
+        ++_stats.occluderCount;
+
+        const auto& mesh = object.model->getOccluderMesh();
+        const glm::mat4 modelViewProjection = projectionView * object.modelMatrix;
+        _screenPositions.resize(mesh.positions.size());
+        for (size_t i = 0; i < mesh.positions.size(); i++) {
+            const glm::vec4 clip = modelViewProjection * glm::vec4(mesh.positions[i], 1.0f);
+            if (clip.z < 0.0f || clip.w <= 0.0f) {
+                _screenPositions[i] = glm::vec3(0.0f, 0.0f, -1.0f);
+                continue;
+            }
+            _screenPositions[i] = glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * WIDTH,
+                                            (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT,
+                                            clip.z / clip.w);
+        }
+
+        // Clipping would add vertices, and dropping triangles that reach behind the near plane only ever
+        // makes the culling more conservative
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const glm::vec3& v0 = _screenPositions[mesh.indices[i]];
+            const glm::vec3& v1 = _screenPositions[mesh.indices[i + 1]];
+            const glm::vec3& v2 = _screenPositions[mesh.indices[i + 2]];
+            if (v0.z >= 0.0f && v1.z >= 0.0f && v2.z >= 0.0f) {
+                addTriangle(v0, v1, v2);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::addTriangle(const glm::vec3& v0, glm::vec3 v1, glm::vec3 v2) {
+    // Both faces are drawn, so the winding is made counterclockwise whatever the mesh's
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (area < 0.0f) {
+        std::swap(v1, v2);
+        area = -area;
+    }
+    if (area <= 0.0f) {
+        return;
+    }
+
+    // Pixel centers sit at half coordinates
+    Triangle triangle{};
+    triangle.minX = std::max(static_cast<int>(std::ceil(std::min({v0.x, v1.x, v2.x}) - 0.5f)), 0);
+    triangle.maxX = std::min(static_cast<int>(std::floor(std::max({v0.x, v1.x, v2.x}) - 0.5f)),
+                             static_cast<int>(WIDTH) - 1);
+    triangle.minY = std::max(static_cast<int>(std::ceil(std::min({v0.y, v1.y, v2.y}) - 0.5f)), 0);
+    triangle.maxY = std::min(static_cast<int>(std::floor(std::max({v0.y, v1.y, v2.y}) - 0.5f)),
+                             static_cast<int>(HEIGHT) - 1);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+        return;
+    }
+
+    const glm::vec3* vertices[3] = {&v0, &v1, &v2};
+    for (int edge = 0; edge < 3; edge++) {
+        const glm::vec3& from = *vertices[(edge + 1) % 3];
+        const glm::vec3& to = *vertices[(edge + 2) % 3];
+        triangle.edgeA[edge] = from.y - to.y;
+        triangle.edgeB[edge] = to.x - from.x;
+        triangle.edgeC[edge] = from.x * to.y - from.y * to.x;
+    }
+
+    triangle.depthA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+    triangle.depthB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+    triangle.depthC = v0.z - triangle.depthA * v0.x - triangle.depthB * v0.y;
+    _triangles.push_back(triangle);
+}
+
+void OcclusionCuller::rasterizeBand(uint32_t band) {
+    const int minY = static_cast<int>(band * BAND_HEIGHT);
+    const int maxY = minY + static_cast<int>(BAND_HEIGHT) - 1;
+    std::fill(_depth.begin() + minY * WIDTH, _depth.begin() + (maxY + 1) * WIDTH, 1.0f);
+
+    for (const auto& triangle : _triangles) {
+        if (triangle.maxY >= minY && triangle.minY <= maxY) {
+            rasterizeTriangle(triangle, std::max(triangle.minY, minY), std::min(triangle.maxY, maxY));
+        }
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const Triangle& triangle, int minY, int maxY) {
+#if defined(VGE_OCCLUSION_AVX2)
+    // Each step covers 8 aligned pixels of a row, the edge functions and depth advancing by 8 pixels
+    const __m256 laneX = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const int firstX = triangle.minX & ~7;
+    __m256 edgeA[3], edgeStep[3];
+    for (int edge = 0; edge < 3; edge++) {
+        edgeA[edge] = _mm256_set1_ps(triangle.edgeA[edge]);
+        edgeStep[edge] = _mm256_set1_ps(triangle.edgeA[edge] * 8.0f);
+    }
+    const __m256 depthA = _mm256_set1_ps(triangle.depthA);
+    const __m256 depthStep = _mm256_set1_ps(triangle.depthA * 8.0f);
+
+    for (int y = minY; y <= maxY; y++) {
+        const float centerY = static_cast<float>(y) + 0.5f;
+        const __m256 x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(firstX)), laneX);
+        __m256 edges[3];
+        for (int edge = 0; edge < 3; edge++) {
+            const float rowStart = triangle.edgeB[edge] * centerY + triangle.edgeC[edge];
+            edges[edge] = _mm256_fmadd_ps(edgeA[edge], x, _mm256_set1_ps(rowStart));
+        }
+        const float depthRowStart = triangle.depthB * centerY + triangle.depthC;
+        __m256 depth = _mm256_fmadd_ps(depthA, x, _mm256_set1_ps(depthRowStart));
+
+        float* row = &_depth[y * WIDTH];
+        for (int pixel = firstX; pixel <= triangle.maxX; pixel += 8) {
+            // The sign bit is set wherever any edge function is negative, outside the triangle
+            const __m256 outside = _mm256_or_ps(edges[0], _mm256_or_ps(edges[1], edges[2]));
+            if (_mm256_movemask_ps(outside) != 0xFF) {
+                const __m256 stored = _mm256_loadu_ps(row + pixel);
+                const __m256 nearer = _mm256_min_ps(stored, depth);
+                _mm256_storeu_ps(row + pixel, _mm256_blendv_ps(nearer, stored, outside));
+            }
+            for (int edge = 0; edge < 3; edge++) {
+                edges[edge] = _mm256_add_ps(edges[edge], edgeStep[edge]);
+            }
+            depth = _mm256_add_ps(depth, depthStep);
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        const float centerY = static_cast<float>(y) + 0.5f;
+        float* row = &_depth[y * WIDTH];
+        for (int pixel = triangle.minX; pixel <= triangle.maxX; pixel++) {
+            const float centerX = static_cast<float>(pixel) + 0.5f;
+            bool inside = true;
+            for (int edge = 0; edge < 3; edge++) {
+                const float value =
+                    triangle.edgeA[edge] * centerX + triangle.edgeB[edge] * centerY + triangle.edgeC[edge];
+                inside = inside && value >= 0.0f;
+            }
+            if (inside) {
+                const float depth = triangle.depthA * centerX + triangle.depthB * centerY + triangle.depthC;
+                row[pixel] = std::min(row[pixel], depth);
+            }
+        }
+    }
+#endif
+}
+
+bool OcclusionCuller::testObject(const glm::mat4& projectionView, const RenderObject& object) const {
+    const auto& box = object.model->getBoundingBox();
+    const glm::mat4 modelViewProjection = projectionView * object.modelMatrix;
+
+    glm::vec2 screenMin{static_cast<float>(WIDTH), static_cast<float>(HEIGHT)};
+    glm::vec2 screenMax{0.0f};
+    float nearestDepth = 1.0f;
+    for (int corner = 0; corner < 8; corner++) {
+        const glm::vec3 position{corner & 1 ? box.max.x : box.min.x,
+                                 corner & 2 ? box.max.y : box.min.y,
+                                 corner & 4 ? box.max.z : box.min.z};
+        const glm::vec4 clip = modelViewProjection * glm::vec4(position, 1.0f);
+        if (clip.z < 0.0f || clip.w <= 0.0f) {
+            return true;
+        }
+        const glm::vec2 screen{(clip.x / clip.w * 0.5f + 0.5f) * WIDTH,
+                               (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT};
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearestDepth = std::min(nearestDepth, clip.z / clip.w);
+    }
+
+    // Every pixel the rectangle touches, not only those whose centers it covers
+    const int minX = std::max(static_cast<int>(std::floor(screenMin.x)), 0);
+    const int maxX = std::min(static_cast<int>(std::floor(screenMax.x)), static_cast<int>(WIDTH) - 1);
+    const int minY = std::max(static_cast<int>(std::floor(screenMin.y)), 0);
+    const int maxY = std::min(static_cast<int>(std::floor(screenMax.y)), static_cast<int>(HEIGHT) - 1);
+    if (minX > maxX || minY > maxY) {
+        return true;
+    }
+
+    // Visible wherever no occluder lies nearer than the object's nearest point
+#if defined(VGE_OCCLUSION_AVX2)
+    const int firstX = minX & ~7;
+    const __m256i laneX = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i beforeMin = _mm256_set1_epi32(minX - 1);
+    const __m256i afterMax = _mm256_set1_epi32(maxX + 1);
+    const __m256 depth = _mm256_set1_ps(nearestDepth);
+    for (int y = minY; y <= maxY; y++) {
+        const float* row = &_depth[y * WIDTH];
+        for (int pixel = firstX; pixel <= maxX; pixel += 8) {
+            const __m256i x = _mm256_add_epi32(_mm256_set1_epi32(pixel), laneX);
+            const __m256i inRect =
+                _mm256_and_si256(_mm256_cmpgt_epi32(x, beforeMin), _mm256_cmpgt_epi32(afterMax, x));
+            const __m256 unoccluded = _mm256_cmp_ps(_mm256_loadu_ps(row + pixel), depth, _CMP_GE_OQ);
+            if (_mm256_movemask_ps(_mm256_and_ps(unoccluded, _mm256_castsi256_ps(inRect))) != 0) {
+                return true;
+            }
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        const float* row = &_depth[y * WIDTH];
+        for (int pixel = minX; pixel <= maxX; pixel++) {
+            if (row[pixel] >= nearestDepth) {
+                return true;
+            }
+        }
+    }
+#endif
+    return false;
+}
+
+}  // namespace vge
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "FrameInfo.h"
+#include "ThreadPool.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <future>
+#include <vector>
+
+namespace vge {
+
+// Software occlusion culling. The occluder meshes of the objects marked as occluders are rasterized into a
+// small depth buffer, then each object's screen-space bounding rectangle is tested against it: an object
+// whose nearest point lies behind the occluders at every pixel of its rectangle is hidden. The buffer is
+// split into horizontal bands rasterized in parallel on worker threads, the objects into batches tested in
+// parallel. With AVX2 both work on 8 pixels of a row at a time.
+class OcclusionCuller {
+public:
+    // Covers the framebuffer whatever its size, 4:3 like the default window
+    static constexpr uint32_t WIDTH = 256;
+    static constexpr uint32_t HEIGHT = 192;
+    // Rows per raster job
+    static constexpr uint32_t BAND_HEIGHT = 24;
+    // Objects per test job
+    static constexpr uint32_t TEST_BATCH_SIZE = 256;
+
+    // Results of the last finished cull, times in milliseconds
+    struct Stats {
+        uint32_t occluderCount;
+        // Rasterized, those in front of the near plane
+        uint32_t triangleCount;
+        uint32_t occludedCount;
+        // Transforming the occluders included
+        float rasterTime;
+        float testTime;
+    };
+
+    explicit OcclusionCuller(size_t threadCount = defaultThreadCount());
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller &operator=(const OcclusionCuller&) = delete;
+
+    // Starts culling the objects as seen through projectionView and returns right away. The objects must
+    // stay unchanged until finish returns.
+    void begin(const glm::mat4& projectionView, const std::vector<RenderObject>& objects);
+    // Waits for the cull begin started, returning false if there is none. Rethrows what it threw.
+    bool finish();
+
+    // 1 for each object that may be visible, 0 for each hidden behind the occluders. Objects off screen or
+    // crossing the near plane count as visible, that is for frustum culling to decide.
+    inline const std::vector<uint8_t>& getVisibility() const { return _visibility; }
+    inline const Stats& getStats() const { return _stats; }
+    // Row-major, 1 where no occluder was drawn
+    inline const std::vector<float>& getDepthBuffer() const { return _depth; }
+
+    // Leaves a core each to the render and simulation threads
+    static size_t defaultThreadCount();
+    // Name of the compiled-in path: "AVX2" or "scalar"
+    static const char* simdPath();
+
+private:
+    // In buffer pixels, wound so that the edge functions are non-negative inside
+    struct Triangle {
+        // Edge i, opposite vertex i, is a * x + b * y + c
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        // Depth plane: z = depthC + depthA * x + depthB * y
+        float depthA;
+        float depthB;
+        float depthC;
+        // Pixels whose centers may be covered, inclusive and within the buffer
+        int minX, maxX, minY, maxY;
+    };
+
+    void cull(const glm::mat4& projectionView, const std::vector<RenderObject>& objects);
+    void setupTriangles(const glm::mat4& projectionView, const std::vector<RenderObject>& objects);
+    void addTriangle(const glm::vec3& v0, glm::vec3 v1, glm::vec3 v2);
+    void rasterizeBand(uint32_t band);
+    void rasterizeTriangle(const Triangle& triangle, int minY, int maxY);
+    bool testObject(const glm::mat4& projectionView, const RenderObject& object) const;
+    // Runs job(0) to job(count - 1) on the workers and waits for all of them
+    template <typename F>
+    void parallelFor(uint32_t count, const F& job);
+
+private:
+    std::vector<float> _depth;
+    std::vector<Triangle> _triangles;
+    // Screen-space positions of the occluder being set up, z < 0 for those behind the near plane
+    std::vector<glm::vec3> _screenPositions;
+    std::vector<uint8_t> _visibility;
+    Stats _stats{};
+
+    ThreadPool _workers;
+    // Runs each cull, which hands its bands and batches to the workers and waits for them
+    ThreadPool _cullThread{1};
+    std::future<void> _job;
+};
+
+}  // namespace vge
@@ -0,0 +1,386 @@
+#include "OffscreenTarget.h"
+
+#include <array>
+#include <limits>
+#include <stdexcept>
+
+namespace vge {
+
+OffscreenTarget::OffscreenTarget(Device &device,
+                                 VkExtent2D extent,
+                                 ShadingPath shadingPath,
+                                 bool depthSampling)
+    : _device{device}
+    , _extent{extent}
+    , _shadingPath{shadingPath}
+    , _depthSampling{depthSampling} {
+    _depthFormat = _device.findSupportedFormat(
+        {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+    createRenderPass();
+    createImages();
+    createFramebuffers();
+    createReadbackBuffers();
+    createSyncObjects();
+}
+
+OffscreenTarget::~OffscreenTarget() {
+    for (auto framebuffer : _framebuffers) {
+        vkDestroyFramebuffer(_device.getVkDevice(), framebuffer, nullptr);
+    }
+
+    for (size_t i = 0; i < _colorImages.size(); i++) {
+        vkDestroyImageView(_device.getVkDevice(), _colorImageViews[i], nullptr);
+        vkDestroyImage(_device.getVkDevice(), _colorImages[i], nullptr);
+        vkFreeMemory(_device.getVkDevice(), _colorImageMemorys[i], nullptr);
+
+        vkDestroyImageView(_device.getVkDevice(), _depthImageViews[i], nullptr);
+        vkDestroyImage(_device.getVkDevice(), _depthImages[i], nullptr);
+        vkFreeMemory(_device.getVkDevice(), _depthImageMemorys[i], nullptr);
+    }
+
+    vkDestroyRenderPass(_device.getVkDevice(), _renderPass, nullptr);
+    vkDestroyRenderPass(_device.getVkDevice(), _loadRenderPass, nullptr);
+
+    for (auto fence : _inFlightFences) {
+        vkDestroyFence(_device.getVkDevice(), fence, nullptr);
+    }
+}
+
+VkResult OffscreenTarget::acquireNextImage(uint32_t *imageIndex) {
+    vkWaitForFences(
+        _device.getVkDevice(), 1, &_inFlightFences[_currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+    // The frame that last used this slot is complete, so its pixels can be read without waiting
+    deliverReadback(_currentFrame);
+
+    *imageIndex = static_cast<uint32_t>(_currentFrame);
+    return VK_SUCCESS;
+}
+
+VkResult OffscreenTarget::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = buffers;
+
+    vkResetFences(_device.getVkDevice(), 1, &_inFlightFences[_currentFrame]);
+    if (vkQueueSubmit(_device.getGraphicsQueue(), 1, &submitInfo, _inFlightFences[_currentFrame]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit draw command buffer!");
+    }
+
+    _readbackPending[_currentFrame] = _readbackCallback != nullptr;
+    _currentFrame = (_currentFrame + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+    return VK_SUCCESS;
+}
+
+void OffscreenTarget::recordFrameEnd(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    if (_readbackCallback == nullptr) {
+        return;
+    }
+
+    // The render pass leaves the color image in TRANSFER_SRC_OPTIMAL
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {_extent.width, _extent.height, 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer,
+                           _colorImages[imageIndex],
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           _readbackBuffers[imageIndex]->getBuffer(),
+                           1,
+                           &region);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = _readbackBuffers[imageIndex]->getBuffer();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr);
+}
+
+void OffscreenTarget::flushReadbacks() {
+    vkWaitForFences(_device.getVkDevice(),
+                    static_cast<uint32_t>(_inFlightFences.size()),
+                    _inFlightFences.data(),
+                    VK_TRUE,
+                    std::numeric_limits<uint64_t>::max());
+
+    // Oldest frame first
+    for (size_t i = 0; i < _inFlightFences.size(); i++) {
+        deliverReadback((_currentFrame + i) % _inFlightFences.size());
+    }
+}
+
+void OffscreenTarget::deliverReadback(size_t frame) {
+    if (!_readbackPending[frame]) {
+        return;
+    }
+    _readbackPending[frame] = false;
+
+    if (_readbackCallback == nullptr) {
+        return;
+    }
+
+    _readbackBuffers[frame]->invalidate();
+    _readbackCallback(_readbackBuffers[frame]->getMappedMemory(), _extent);
+}
+
+void OffscreenTarget::createRenderPass() {
+    if (_shadingPath == ShadingPath::Deferred) {
+        _renderPass = GBuffer::createRenderPass(
+            _device, COLOR_FORMAT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _depthFormat, _renderPassSignature);
+        return;
+    }
+
+    _renderPass = createForwardRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR);
+    if (_depthSampling) {
+        _loadRenderPass = createForwardRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD);
+    }
+}
+
+VkRenderPass OffscreenTarget::createForwardRenderPass(VkAttachmentLoadOp loadOp) {
+    // Loading continues a frame whose first render pass left the attachments in their final layouts
+    const bool load = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = _depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = loadOp;
+    // Stored for the depth pyramid and for a render pass that loads it, otherwise it can stay on chip
+    depthAttachment.storeOp =
+        _depthSampling ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout =
+        load ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentDescription colorAttachment = {};
+    colorAttachment.format = COLOR_FORMAT;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = loadOp;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.initialLayout = load ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef = {};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    std::array<VkSubpassDependency, 2> dependencies{};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask =
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    if (load) {
+        // Color written by the frame's previous render pass, which blending reads back. Depth is handed over
+        // by the barrier that returns it from sampling.
+        dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+    }
+
+    // Make color writes visible to the readback copy recorded after the render pass
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    // The variant that loads is compatible, pipelines are built for the one that clears
+    if (!load) {
+        _renderPassSignature = RenderPassSignature::fromCreateInfo(renderPassInfo);
+    }
+
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(_device.getVkDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render pass!");
+    }
+    return renderPass;
+}
+
+void OffscreenTarget::createImages() {
+    const size_t imageCount = SwapChain::MAX_FRAMES_IN_FLIGHT;
+
+    _colorImages.resize(imageCount);
+    _colorImageMemorys.resize(imageCount);
+    _colorImageViews.resize(imageCount);
+    _depthImages.resize(imageCount);
+    _depthImageMemorys.resize(imageCount);
+    _depthImageViews.resize(imageCount);
+
+    for (size_t i = 0; i < imageCount; i++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = _extent.width;
+        imageInfo.extent.height = _extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = COLOR_FORMAT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.flags = 0;
+
+        _device.createImageWithInfo(
+            imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _colorImages[i], _colorImageMemorys[i]);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = _colorImages[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = COLOR_FORMAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(_device.getVkDevice(), &viewInfo, nullptr, &_colorImageViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+
+        // Deferred uses the G-buffer's depth, the handles stay null
+        if (_shadingPath == ShadingPath::Deferred) {
+            continue;
+        }
+
+        imageInfo.format = _depthFormat;
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        // Sampled to build the depth pyramid for occlusion culling
+        if (_depthSampling) {
+            imageInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        }
+
+        _device.createImageWithInfo(
+            imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _depthImages[i], _depthImageMemorys[i]);
+
+        viewInfo.image = _depthImages[i];
+        viewInfo.format = _depthFormat;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+        if (vkCreateImageView(_device.getVkDevice(), &viewInfo, nullptr, &_depthImageViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+    }
+
+    if (_shadingPath == ShadingPath::Deferred) {
+        _gBuffer = std::make_unique<GBuffer>(_device, _extent, _depthFormat, imageCount);
+    }
+}
+
+void OffscreenTarget::createFramebuffers() {
+    _framebuffers.resize(_colorImageViews.size());
+    for (size_t i = 0; i < _framebuffers.size(); i++) {
+        std::vector<VkImageView> attachments;
+        if (_shadingPath == ShadingPath::Deferred) {
+            const auto &gBufferAttachments = _gBuffer->getAttachments(i);
+            attachments = {_colorImageViews[i],
+                           gBufferAttachments.depth,
+                           gBufferAttachments.albedo,
+                           gBufferAttachments.normal};
+        } else {
+            attachments = {_colorImageViews[i], _depthImageViews[i]};
+        }
+
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = _renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = _extent.width;
+        framebufferInfo.height = _extent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(_device.getVkDevice(), &framebufferInfo, nullptr, &_framebuffers[i]) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create framebuffer!");
+        }
+    }
+}
+
+void OffscreenTarget::createReadbackBuffers() {
+    _readbackBuffers.resize(_colorImages.size());
+    _readbackPending.resize(_colorImages.size(), false);
+
+    for (auto &buffer : _readbackBuffers) {
+        buffer = std::make_unique<Buffer>(_device,
+                                          4,
+                                          _extent.width * _extent.height,
+                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        buffer->map();
+    }
+}
+
+void OffscreenTarget::createSyncObjects() {
+    _inFlightFences.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for (auto &fence : _inFlightFences) {
+        if (vkCreateFence(_device.getVkDevice(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        }
+    }
+}
+
+}  // namespace vge
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Device.h"
+#include "RenderTarget.h"
+#include "SwapChain.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace vge {
+
+// Renders into plain color/depth images instead of a window swap chain. Used by headless mode,
+// where there is no surface and no present queue.
+class OffscreenTarget : public RenderTarget {
+public:
+    // sRGB like the swap chain, so the shaders' linear output is encoded the same way in captures
+    static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+    // Receives tightly packed RGBA8 pixels of a finished frame
+    using ReadbackCallback = std::function<void(const void *pixels, VkExtent2D extent)>;
+
+    // depthSampling as for SwapChain
+    OffscreenTarget(Device &device,
+                    VkExtent2D extent,
+                    ShadingPath shadingPath = ShadingPath::Forward,
+                    bool depthSampling = false);
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget &) = delete;
+    OffscreenTarget &operator=(const OffscreenTarget &) = delete;
+
+    inline VkFramebuffer getFrameBuffer(int index) const override { return _framebuffers[index]; }
+    inline VkRenderPass getRenderPass() const override { return _renderPass; }
+    inline VkRenderPass getLoadRenderPass() const override { return _loadRenderPass; }
+    inline const RenderPassSignature &getRenderPassSignature() const override { return _renderPassSignature; }
+    inline VkExtent2D getExtent() const override { return _extent; }
+    inline ShadingPath getShadingPath() const override { return _shadingPath; }
+    inline const GBuffer::Attachments &getGBufferAttachments(int index) const override {
+        return _gBuffer->getAttachments(index);
+    }
+    inline DepthAttachment getDepthAttachment(int index) const override {
+        return {_depthImages[index], _depthImageViews[index], _depthFormat, _extent};
+    }
+
+    VkResult acquireNextImage(uint32_t *imageIndex) override;
+    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) override;
+    void recordFrameEnd(VkCommandBuffer commandBuffer, uint32_t imageIndex) override;
+
+    // Readbacks are delivered without stalling: a frame's pixels are handed to the callback the next
+    // time its slot is reused, or when flushReadbacks is called
+    inline void setReadbackCallback(ReadbackCallback callback) { _readbackCallback = std::move(callback); }
+    void flushReadbacks();
+
+private:
+    void createRenderPass();
+    VkRenderPass createForwardRenderPass(VkAttachmentLoadOp loadOp);
+    void createImages();
+    void createFramebuffers();
+    void createReadbackBuffers();
+    void createSyncObjects();
+
+    void deliverReadback(size_t frame);
+
+private:
+    Device &_device;
+    VkExtent2D _extent;
+    ShadingPath _shadingPath;
+    bool _depthSampling;
+    VkFormat _depthFormat;
+    VkRenderPass _renderPass;
+    RenderPassSignature _renderPassSignature;
+    // Forward only
+    VkRenderPass _loadRenderPass = VK_NULL_HANDLE;
+
+    std::vector<VkImage> _colorImages;
+    std::vector<VkDeviceMemory> _colorImageMemorys;
+    std::vector<VkImageView> _colorImageViews;
+    // Deferred only, replaces the depth images
+    std::unique_ptr<GBuffer> _gBuffer;
+    std::vector<VkImage> _depthImages;
+    std::vector<VkDeviceMemory> _depthImageMemorys;
+    std::vector<VkImageView> _depthImageViews;
+    std::vector<VkFramebuffer> _framebuffers;
+
+    std::vector<std::unique_ptr<Buffer>> _readbackBuffers;
+    std::vector<bool> _readbackPending;
+    ReadbackCallback _readbackCallback;
+
+    std::vector<VkFence> _inFlightFences;
+    size_t _currentFrame = 0;
+};
+
+}  // namespace vge
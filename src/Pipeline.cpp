@@ -1,59 +1,210 @@
 #include "Pipeline.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 #include "Model.h"
 #include "Utils.h"
 
 namespace vge {
 
+// Flattens every piece of fixed-function state into integers so descriptions can be hashed and compared
+// without tripping over struct padding or the pointers inside the Vulkan create infos
+static std::vector<uint64_t> pipelineStateKey(const PipelineConfigInfo& configInfo) {
+    std::vector<uint64_t> key;
+    auto add = [&key](auto value) {
+        if constexpr (std::is_floating_point_v<decltype(value)>) {
+            uint32_t bits;
+            float floatValue = static_cast<float>(value);
+            std::memcpy(&bits, &floatValue, sizeof(bits));
+            key.push_back(bits);
+        } else if constexpr (std::is_pointer_v<decltype(value)>) {
+            key.push_back(reinterpret_cast<uintptr_t>(value));
+        } else {
+            key.push_back(static_cast<uint64_t>(value));
+        }
+    };
+
+    for (const auto& binding : configInfo.bindingDescriptions) {
+        add(binding.binding);
+        add(binding.stride);
+        add(binding.inputRate);
+    }
+    add(configInfo.bindingDescriptions.size());
+    for (const auto& attribute : configInfo.attributeDescriptions) {
+        add(attribute.location);
+        add(attribute.binding);
+        add(attribute.format);
+        add(attribute.offset);
+    }
+    add(configInfo.attributeDescriptions.size());
+
+    add(configInfo.viewportInfo.viewportCount);
+    add(configInfo.viewportInfo.scissorCount);
+
+    add(configInfo.inputAssemblyInfo.topology);
+    add(configInfo.inputAssemblyInfo.primitiveRestartEnable);
+
+    const auto& rasterization = configInfo.rasterizationInfo;
+    add(rasterization.depthClampEnable);
+    add(rasterization.rasterizerDiscardEnable);
+    add(rasterization.polygonMode);
+    add(rasterization.cullMode);
+    add(rasterization.frontFace);
+    add(rasterization.depthBiasEnable);
+    add(rasterization.depthBiasConstantFactor);
+    add(rasterization.depthBiasClamp);
+    add(rasterization.depthBiasSlopeFactor);
+    add(rasterization.lineWidth);
+
+    const auto& multisample = configInfo.multisampleInfo;
+    add(multisample.rasterizationSamples);
+    add(multisample.sampleShadingEnable);
+    add(multisample.minSampleShading);
+    add(multisample.alphaToCoverageEnable);
+    add(multisample.alphaToOneEnable);
+
+    const auto& blend = configInfo.colorBlendAttachment;
+    add(blend.blendEnable);
+    add(blend.srcColorBlendFactor);
+    add(blend.dstColorBlendFactor);
+    add(blend.colorBlendOp);
+    add(blend.srcAlphaBlendFactor);
+    add(blend.dstAlphaBlendFactor);
+    add(blend.alphaBlendOp);
+    add(blend.colorWriteMask);
+    add(configInfo.colorAttachmentCount);
+    add(configInfo.colorBlendInfo.logicOpEnable);
+    add(configInfo.colorBlendInfo.logicOp);
+    for (float constant : configInfo.colorBlendInfo.blendConstants) {
+        add(constant);
+    }
+
+    const auto& depthStencil = configInfo.depthStencilInfo;
+    add(depthStencil.depthTestEnable);
+    add(depthStencil.depthWriteEnable);
+    add(depthStencil.depthCompareOp);
+    add(depthStencil.depthBoundsTestEnable);
+    add(depthStencil.stencilTestEnable);
+    add(depthStencil.minDepthBounds);
+    add(depthStencil.maxDepthBounds);
+
+    for (auto dynamicState : configInfo.dynamicStateEnables) {
+        add(dynamicState);
+    }
+    add(configInfo.dynamicStateEnables.size());
+
+    add(configInfo.pipelineLayout);
+    add(configInfo.pushConstantSize);
+    for (uint64_t value : configInfo.renderPassSignature.key) {
+        add(value);
+    }
+    add(configInfo.renderPassSignature.key.size());
+    add(configInfo.subpass);
+
+    for (const auto& constant : configInfo.specializationConstants) {
+        add(constant.constantId);
+        add(constant.value);
+    }
+    add(configInfo.specializationConstants.size());
+
+    return key;
+}
+
+size_t PipelineDesc::hash() const {
+    size_t seed = 0;
+    Utils::hashCombine(seed, vertFilepath, fragFilepath);
+    for (uint64_t value : pipelineStateKey(configInfo)) {
+        Utils::hashCombine(seed, value);
+    }
+    return seed;
+}
+
+bool PipelineDesc::operator==(const PipelineDesc& other) const {
+    return vertFilepath == other.vertFilepath && fragFilepath == other.fragFilepath &&
+           pipelineStateKey(configInfo) == pipelineStateKey(other.configInfo);
+}
+
+Pipeline::Pipeline(Device& device,
+                   std::shared_ptr<ShaderModule> vertShaderModule,
+                   std::shared_ptr<ShaderModule> fragShaderModule,
+                   const PipelineConfigInfo& configInfo)
+    : _device{device}
+    , _vertShaderModule{std::move(vertShaderModule)}
+    , _fragShaderModule{std::move(fragShaderModule)} {
+    createGraphicsPipeline(configInfo);
+}
+
 Pipeline::Pipeline(Device& device,
                    const std::string& vertFilepath,
                    const std::string& fragFilepath,
                    const PipelineConfigInfo& configInfo)
-    : _device{device} {
-    createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
-}
+    : Pipeline(device,
+               std::make_shared<ShaderModule>(device, vertFilepath),
+               fragFilepath.empty() ? nullptr : std::make_shared<ShaderModule>(device, fragFilepath),
+               configInfo) {}
+
+Pipeline::~Pipeline() { vkDestroyPipeline(_device.getVkDevice(), _graphicsPipeline, nullptr); }
 
-Pipeline::~Pipeline() {
-    vkDestroyShaderModule(_device.getVkDevice(), _vertShaderModule, nullptr);
-    vkDestroyShaderModule(_device.getVkDevice(), _fragShaderModule, nullptr);
-    vkDestroyPipeline(_device.getVkDevice(), _graphicsPipeline, nullptr);
+void Pipeline::swap(Pipeline& other) {
+    std::swap(_graphicsPipeline, other._graphicsPipeline);
+    std::swap(_vertShaderModule, other._vertShaderModule);
+    std::swap(_fragShaderModule, other._fragShaderModule);
 }
 
-void Pipeline::createGraphicsPipeline(const std::string& vertFilepath,
-                                      const std::string& fragFilepath,
-                                      const PipelineConfigInfo& configInfo) {
+void Pipeline::createGraphicsPipeline(const PipelineConfigInfo& configInfo) {
     assert(configInfo.pipelineLayout != VK_NULL_HANDLE &&
            "Cannot create graphics pipeline: no pipelineLayout provided in configInfo");
     assert(configInfo.renderPass != VK_NULL_HANDLE &&
            "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
-    auto vertCode = Utils::readFile(vertFilepath);
-    auto fragCode = Utils::readFile(fragFilepath);
+    validateShaderInterface(configInfo);
+
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+    std::vector<uint32_t> specializationData;
+    for (const auto& constant : configInfo.specializationConstants) {
+        VkSpecializationMapEntry entry{};
+        entry.constantID = constant.constantId;
+        entry.offset = static_cast<uint32_t>(specializationData.size() * sizeof(uint32_t));
+        entry.size = sizeof(uint32_t);
+        specializationEntries.push_back(entry);
+        specializationData.push_back(constant.value);
+    }
 
-    createShaderModule(vertCode, &_vertShaderModule);
-    createShaderModule(fragCode, &_fragShaderModule);
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+    specializationInfo.pMapEntries = specializationEntries.data();
+    specializationInfo.dataSize = specializationData.size() * sizeof(uint32_t);
+    specializationInfo.pData = specializationData.data();
 
+    const VkSpecializationInfo* pSpecializationInfo =
+        specializationEntries.empty() ? nullptr : &specializationInfo;
+
+    uint32_t stageCount = _fragShaderModule != nullptr ? 2 : 1;
     VkPipelineShaderStageCreateInfo shaderStages[2];
     shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shaderStages[0].module = _vertShaderModule;
+    shaderStages[0].module = _vertShaderModule->getShaderModule();
     shaderStages[0].pName = "main";
     shaderStages[0].flags = 0;
     shaderStages[0].pNext = nullptr;
-    shaderStages[0].pSpecializationInfo = nullptr;
+    shaderStages[0].pSpecializationInfo = pSpecializationInfo;
 
-    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStages[1].module = _fragShaderModule;
-    shaderStages[1].pName = "main";
-    shaderStages[1].flags = 0;
-    shaderStages[1].pNext = nullptr;
-    shaderStages[1].pSpecializationInfo = nullptr;
+    if (_fragShaderModule != nullptr) {
+        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = _fragShaderModule->getShaderModule();
+        shaderStages[1].pName = "main";
+        shaderStages[1].flags = 0;
+        shaderStages[1].pNext = nullptr;
+        shaderStages[1].pSpecializationInfo = pSpecializationInfo;
+    }
 
     const auto& bindingDescriptions = configInfo.bindingDescriptions;
     const auto& attributeDescriptions = configInfo.attributeDescriptions;
@@ -64,18 +215,28 @@ void Pipeline::createGraphicsPipeline(const std::string& vertFilepath,
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
     vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
+    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(configInfo.colorAttachmentCount,
+                                                                          configInfo.colorBlendAttachment);
+    VkPipelineColorBlendStateCreateInfo colorBlendInfo = configInfo.colorBlendInfo;
+    colorBlendInfo.attachmentCount = configInfo.colorAttachmentCount;
+    colorBlendInfo.pAttachments = colorBlendAttachments.data();
+
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo = configInfo.dynamicStateInfo;
+    dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
+    dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
+
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
+    pipelineInfo.stageCount = stageCount;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
     pipelineInfo.pViewportState = &configInfo.viewportInfo;
     pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
     pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
-    pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+    pipelineInfo.pColorBlendState = &colorBlendInfo;
     pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
-    pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
+    pipelineInfo.pDynamicState = &dynamicStateInfo;
 
     pipelineInfo.layout = configInfo.pipelineLayout;
     pipelineInfo.renderPass = configInfo.renderPass;
@@ -85,25 +246,59 @@ void Pipeline::createGraphicsPipeline(const std::string& vertFilepath,
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
     if (vkCreateGraphicsPipelines(
-            _device.getVkDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphicsPipeline) !=
+            _device.getVkDevice(), _device.getPipelineCache(), 1, &pipelineInfo, nullptr, &_graphicsPipeline) !=
         VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline");
     }
 }
 
-void Pipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+void Pipeline::validateShaderInterface(const PipelineConfigInfo& configInfo) const {
+    const std::string& vertFilepath = _vertShaderModule->getFilepath();
+
+    for (const auto& input : _vertShaderModule->getReflection().inputs) {
+        auto attribute = std::find_if(configInfo.attributeDescriptions.begin(),
+                                      configInfo.attributeDescriptions.end(),
+                                      [&input](const auto& a) { return a.location == input.location; });
+        if (attribute == configInfo.attributeDescriptions.end()) {
+            throw std::runtime_error(vertFilepath + ": input location " + std::to_string(input.location) +
+                                     " has no vertex attribute!");
+        }
+
+        auto format = getVertexFormatInfo(attribute->format);
+        if (format.componentType != VertexFormatInfo::ComponentType::Unknown &&
+            format.componentType != input.componentType) {
+            throw std::runtime_error(vertFilepath + ": input location " + std::to_string(input.location) +
+                                     " doesn't match the numeric type of its vertex attribute format!");
+        }
+    }
+
+    // Not an error, but every attribute the shader ignores still costs fetch bandwidth
+    for (const auto& attribute : configInfo.attributeDescriptions) {
+        const auto& inputs = _vertShaderModule->getReflection().inputs;
+        if (std::none_of(inputs.begin(), inputs.end(), [&attribute](const auto& input) {
+                return input.location == attribute.location;
+            })) {
+            std::cout << "Warning: " << vertFilepath << " never reads vertex attribute location "
+                      << attribute.location << '\n';
+        }
+    }
+
+    for (const auto* shaderModule : {_vertShaderModule.get(), _fragShaderModule.get()}) {
+        if (shaderModule == nullptr) {
+            continue;
+        }
 
-    if (vkCreateShaderModule(_device.getVkDevice(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module");
+        uint32_t shaderSize = shaderModule->getReflection().pushConstantSize;
+        if (shaderSize > configInfo.pushConstantSize) {
+            throw std::runtime_error(shaderModule->getFilepath() + ": push constant block of " +
+                                     std::to_string(shaderSize) + " bytes exceeds the pipeline layout's " +
+                                     std::to_string(configInfo.pushConstantSize) + " bytes!");
+        }
     }
 }
 
-void Pipeline::bind(VkCommandBuffer commandBuffer) {
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+void Pipeline::bind(CommandRecorder& recorder) {
+    recorder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
 }
 
 void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
@@ -122,8 +317,9 @@ void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
     configInfo.rasterizationInfo.rasterizerDiscardEnable = VK_FALSE;
     configInfo.rasterizationInfo.polygonMode = VK_POLYGON_MODE_FILL;
     configInfo.rasterizationInfo.lineWidth = 1.0f;
-    configInfo.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
-    configInfo.rasterizationInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    // OBJ front faces wind counter-clockwise, and the camera's projection keeps that on screen
+    configInfo.rasterizationInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+    configInfo.rasterizationInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     configInfo.rasterizationInfo.depthBiasEnable = VK_FALSE;
     configInfo.rasterizationInfo.depthBiasConstantFactor = 0.0f;  // Optional
     configInfo.rasterizationInfo.depthBiasClamp = 0.0f;           // Optional
@@ -151,7 +347,7 @@ void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
     configInfo.colorBlendInfo.logicOpEnable = VK_FALSE;
     configInfo.colorBlendInfo.logicOp = VK_LOGIC_OP_COPY;  // Optional
     configInfo.colorBlendInfo.attachmentCount = 1;
-    configInfo.colorBlendInfo.pAttachments = &configInfo.colorBlendAttachment;
+    configInfo.colorBlendInfo.pAttachments = nullptr;  // Set at pipeline creation
     configInfo.colorBlendInfo.blendConstants[0] = 0.0f;  // Optional
     configInfo.colorBlendInfo.blendConstants[1] = 0.0f;  // Optional
     configInfo.colorBlendInfo.blendConstants[2] = 0.0f;  // Optional
@@ -170,13 +366,22 @@ void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
 
     configInfo.dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
     configInfo.dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
+    configInfo.dynamicStateInfo.pDynamicStates = nullptr;  // Set at pipeline creation
     configInfo.dynamicStateInfo.dynamicStateCount =
         static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
     configInfo.dynamicStateInfo.flags = 0;
 
-    configInfo.bindingDescriptions = Model::Vertex::getBindingDescriptions();
-    configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+    setVertexLayout(configInfo, Model::Vertex::layout());
+}
+
+void Pipeline::enableDepthOnly(PipelineConfigInfo& configInfo) {
+    setVertexLayout(configInfo, Model::PositionVertex::layout());
+    configInfo.colorBlendAttachment.colorWriteMask = 0;
+}
+
+void Pipeline::enableDepthEqual(PipelineConfigInfo& configInfo) {
+    configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    configInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
 }
 
 void Pipeline::enableAlphaBlending(PipelineConfigInfo& configInfo) {
@@ -190,4 +395,26 @@ void Pipeline::enableAlphaBlending(PipelineConfigInfo& configInfo) {
     configInfo.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
     configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 }
+
+void Pipeline::enableAdditiveBlending(PipelineConfigInfo& configInfo) {
+    configInfo.colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                                     VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    configInfo.colorBlendAttachment.blendEnable = VK_TRUE;
+    configInfo.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    configInfo.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    configInfo.colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    configInfo.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    configInfo.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+}
+
+void Pipeline::setSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, uint32_t value) {
+    for (auto& constant : configInfo.specializationConstants) {
+        if (constant.constantId == constantId) {
+            constant.value = value;
+            return;
+        }
+    }
+    configInfo.specializationConstants.push_back({constantId, value});
+}
 }  // namespace vge
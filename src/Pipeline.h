@@ -1,16 +1,26 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "CommandRecorder.h"
 #include "Device.h"
+#include "RenderPassSignature.h"
+#include "ShaderModule.h"
+#include "VertexLayout.h"
 
 namespace vge {
 
+// Plain value type. colorBlendInfo.pAttachments and dynamicStateInfo.pDynamicStates are ignored: they
+// are pointed at colorBlendAttachment and dynamicStateEnables when the pipeline is created, so copies
+// never dangle.
 struct PipelineConfigInfo {
-    PipelineConfigInfo() = default;
-    PipelineConfigInfo(const PipelineConfigInfo&) = delete;
-    PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
+    // 4-byte value (int, uint, float bits or VkBool32) applied to every shader stage that declares the ID
+    struct SpecializationConstant {
+        uint32_t constantId;
+        uint32_t value;
+    };
 
     std::vector<VkVertexInputBindingDescription> bindingDescriptions;
     std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
@@ -18,18 +28,45 @@ struct PipelineConfigInfo {
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
     VkPipelineRasterizationStateCreateInfo rasterizationInfo;
     VkPipelineMultisampleStateCreateInfo multisampleInfo;
+    // Applied to every color attachment of the subpass
     VkPipelineColorBlendAttachmentState colorBlendAttachment;
+    uint32_t colorAttachmentCount = 1;
     VkPipelineColorBlendStateCreateInfo colorBlendInfo;
     VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
     std::vector<VkDynamicState> dynamicStateEnables;
     VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+    // From a PipelineLayoutCache, which has one layout per content, so the handle keys the pipeline
     VkPipelineLayout pipelineLayout = nullptr;
+    // Size of the push constant range in pipelineLayout, checked against what the shaders declare
+    uint32_t pushConstantSize = 0;
     VkRenderPass renderPass = nullptr;
+    // Of renderPass. Keys the pipeline in place of the handle, so passes recreated with the same
+    // attachments, or owned by another target, share pipelines.
+    RenderPassSignature renderPassSignature;
     uint32_t subpass = 0;
+    std::vector<SpecializationConstant> specializationConstants;
+};
+
+// Everything that determines a graphics pipeline. Equal descriptions produce interchangeable pipelines.
+// An empty fragFilepath creates a pipeline without a fragment stage, e.g. for depth-only passes.
+struct PipelineDesc {
+    std::string vertFilepath;
+    std::string fragFilepath;
+    PipelineConfigInfo configInfo;
+
+    size_t hash() const;
+    bool operator==(const PipelineDesc& other) const;
+    inline bool operator!=(const PipelineDesc& other) const { return !(*this == other); }
 };
 
 class Pipeline {
 public:
+    // fragShaderModule may be null for a depth-only pipeline
+    Pipeline(Device& device,
+             std::shared_ptr<ShaderModule> vertShaderModule,
+             std::shared_ptr<ShaderModule> fragShaderModule,
+             const PipelineConfigInfo& configInfo);
+    // Loads its own, unshared shader modules. An empty fragFilepath skips the fragment stage.
     Pipeline(Device& device,
              const std::string& vertFilepath,
              const std::string& fragFilepath,
@@ -39,22 +76,37 @@ public:
     Pipeline(const Pipeline&) = delete;
     Pipeline& operator=(const Pipeline&) = delete;
 
-    void bind(VkCommandBuffer commandBuffer);
+    void bind(CommandRecorder& recorder);
+    // Exchanges the compiled pipelines and their shader modules. Used to hot swap a rebuilt pipeline in
+    // between frames while everyone keeps holding the same Pipeline object.
+    void swap(Pipeline& other);
 
     static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
     static void enableAlphaBlending(PipelineConfigInfo& configInfo);
+    // Adds the output to what is already in the attachment, e.g. to accumulate lights
+    static void enableAdditiveBlending(PipelineConfigInfo& configInfo);
+    // Position-only vertex input, no color writes: meant for a pipeline without a fragment shader that
+    // only lays down depth
+    static void enableDepthOnly(PipelineConfigInfo& configInfo);
+    // Depth test EQUAL without writes, so only the fragments that won a preceding depth pre-pass are shaded
+    static void enableDepthEqual(PipelineConfigInfo& configInfo);
+    static void setSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, uint32_t value);
 
-private:
-    void createGraphicsPipeline(const std::string& vertFilepath,
-                                const std::string& fragFilepath,
-                                const PipelineConfigInfo& configInfo);
+    template <typename Layout>
+    static void setVertexLayout(PipelineConfigInfo& configInfo, const Layout& layout) {
+        configInfo.bindingDescriptions = {layout.binding()};
+        configInfo.attributeDescriptions.assign(layout.attributes.begin(), layout.attributes.end());
+    }
 
-    void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+private:
+    void createGraphicsPipeline(const PipelineConfigInfo& configInfo);
+    // Throws if the vertex input or push constant state doesn't match the reflected shader interface
+    void validateShaderInterface(const PipelineConfigInfo& configInfo) const;
 
 private:
     Device& _device;
     VkPipeline _graphicsPipeline;
-    VkShaderModule _vertShaderModule;
-    VkShaderModule _fragShaderModule;
+    std::shared_ptr<ShaderModule> _vertShaderModule;
+    std::shared_ptr<ShaderModule> _fragShaderModule;
 };
 }  // namespace vge
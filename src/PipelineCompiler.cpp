@@ -0,0 +1,68 @@
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace vge {
+
+PipelineCompiler::PipelineCompiler(Device& device, size_t threadCount)
+    : _device{device}
+    , _threadPool{threadCount} {}
+
+size_t PipelineCompiler::defaultThreadCount() {
+    // Leave one core to the main thread, which keeps recording frames while pipelines compile
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+}
+
+PipelineCompiler::PipelineFuture PipelineCompiler::compile(std::shared_ptr<ShaderModule> vertShaderModule,
+                                                           std::shared_ptr<ShaderModule> fragShaderModule,
+                                                           const PipelineConfigInfo& configInfo) {
+    {
+        std::lock_guard<std::mutex> lock{_timingsMutex};
+        if (_submittedCount++ == 0) {
+            _firstSubmitTime = std::chrono::high_resolution_clock::now();
+        }
+    }
+
+    return _threadPool
+        .submit([this, vertShaderModule, fragShaderModule, configInfo]() {
+            auto start = std::chrono::high_resolution_clock::now();
+            auto pipeline = std::make_shared<Pipeline>(_device, vertShaderModule, fragShaderModule, configInfo);
+            auto finish = std::chrono::high_resolution_clock::now();
+
+            auto name = vertShaderModule->getFilepath() + " + "
+                        + (fragShaderModule != nullptr ? fragShaderModule->getFilepath() : "no fragment stage");
+
+            std::lock_guard<std::mutex> lock{_timingsMutex};
+            _timings.push_back({std::move(name),
+                                std::chrono::duration<float, std::chrono::milliseconds::period>(finish - start)
+                                    .count()});
+            _lastFinishTime = std::max(_lastFinishTime, finish);
+
+            return pipeline;
+        })
+        .share();
+}
+
+void PipelineCompiler::printReport() {
+    std::lock_guard<std::mutex> lock{_timingsMutex};
+
+    float total = 0.0f;
+    std::cout << "Pipeline compilation on " << _threadPool.getThreadCount() << " threads ("
+              << (_device.isPipelineCacheWarm() ? "warm" : "cold") << " cache):\n";
+    for (const auto& timing : _timings) {
+        std::cout << "\t" << timing.name << ": " << timing.milliseconds << "ms\n";
+        total += timing.milliseconds;
+    }
+
+    auto wallTime = _timings.empty() ? 0.0f
+                                     : std::chrono::duration<float, std::chrono::milliseconds::period>(
+                                           _lastFinishTime - _firstSubmitTime)
+                                           .count();
+    std::cout << "\t" << _timings.size() << " pipelines, " << total << "ms of compilation in " << wallTime
+              << "ms wall time\n";
+}
+
+}  // namespace vge
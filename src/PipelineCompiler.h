@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Device.h"
+#include "Pipeline.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vge {
+
+// Builds pipelines on worker threads. All workers share the device's pipeline cache, which Vulkan
+// synchronizes internally.
+class PipelineCompiler {
+public:
+    using PipelineFuture = std::shared_future<std::shared_ptr<Pipeline>>;
+
+    explicit PipelineCompiler(Device& device, size_t threadCount = defaultThreadCount());
+
+    PipelineCompiler(const PipelineCompiler&) = delete;
+    PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+    // The pipeline layout and render pass referenced by configInfo must stay alive until the future is ready.
+    // Compilation errors are rethrown from the future's get().
+    PipelineFuture compile(std::shared_ptr<ShaderModule> vertShaderModule,
+                           std::shared_ptr<ShaderModule> fragShaderModule,
+                           const PipelineConfigInfo& configInfo);
+
+    // Prints per-pipeline timings of everything compiled so far
+    void printReport();
+
+    static size_t defaultThreadCount();
+
+private:
+    struct Timing {
+        std::string name;
+        float milliseconds;
+    };
+
+    Device& _device;
+    ThreadPool _threadPool;
+
+    std::mutex _timingsMutex;
+    std::vector<Timing> _timings;
+    size_t _submittedCount = 0;
+    std::chrono::high_resolution_clock::time_point _firstSubmitTime;
+    std::chrono::high_resolution_clock::time_point _lastFinishTime;
+};
+
+}  // namespace vge
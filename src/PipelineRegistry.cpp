@@ -0,0 +1,160 @@
+#include "PipelineRegistry.h"
+
+#include "SwapChain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <unordered_set>
+
+namespace vge {
+
+PipelineRegistry::PipelineRegistry(Device& device, PipelineCompiler& compiler)
+    : _device{device}
+    , _compiler{compiler}
+    , _layoutCache{device}
+    , _pipelineLayoutCache{device} {}
+
+PipelineCompiler::PipelineFuture PipelineRegistry::getPipeline(const PipelineDesc& desc) {
+    assert(_pipelineLayoutCache.contains(desc.configInfo.pipelineLayout) &&
+           "Pipeline layout must come from the registry's pipeline layout cache");
+    std::lock_guard<std::mutex> lock{_mutex};
+
+    auto it = _pipelines.find(desc);
+    if (it != _pipelines.end()) {
+        ++_pipelineHits;
+        return it->second;
+    }
+
+    // Module creation is cheap next to pipeline compilation, so it happens right here under the lock
+    auto pipeline = _compiler.compile(
+        getShaderModuleLocked(desc.vertFilepath), getShaderModuleLocked(desc.fragFilepath), desc.configInfo);
+    _pipelines.emplace(desc, pipeline);
+
+    return pipeline;
+}
+
+std::shared_ptr<ShaderModule> PipelineRegistry::getShaderModule(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return getShaderModuleLocked(filepath);
+}
+
+std::shared_ptr<ShaderModule> PipelineRegistry::getShaderModuleLocked(const std::string& filepath) {
+    // No fragment stage
+    if (filepath.empty()) {
+        return nullptr;
+    }
+
+    auto it = _shaderModules.find(filepath);
+    if (it != _shaderModules.end()) {
+        ++_shaderModuleHits;
+        return it->second;
+    }
+
+    auto shaderModule = std::make_shared<ShaderModule>(_device, filepath, *_blobStore.load(filepath));
+    _shaderModules.emplace(filepath, shaderModule);
+
+    return shaderModule;
+}
+
+static bool isReady(const PipelineCompiler::PipelineFuture& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void PipelineRegistry::reloadShaders(const std::vector<std::string>& filepaths) {
+    std::lock_guard<std::mutex> lock{_mutex};
+
+    std::unordered_set<std::string> reloaded;
+    for (const auto& filepath : filepaths) {
+        auto it = _shaderModules.find(filepath);
+        if (it == _shaderModules.end()) {
+            continue;
+        }
+
+        try {
+            // Pipelines built from the old module keep it alive until they are retired
+            it->second = std::make_shared<ShaderModule>(_device, filepath, *_blobStore.load(filepath));
+            reloaded.insert(filepath);
+        } catch (const std::exception& e) {
+            std::cerr << "Unable to reload " << filepath << ": " << e.what() << std::endl;
+        }
+    }
+
+    // Not a cache hit, and null for the empty path of pipelines without a fragment stage
+    auto findShaderModule = [this](const std::string& filepath) -> std::shared_ptr<ShaderModule> {
+        auto it = _shaderModules.find(filepath);
+        return it != _shaderModules.end() ? it->second : nullptr;
+    };
+
+    for (const auto& [desc, future] : _pipelines) {
+        if (!reloaded.count(desc.vertFilepath) && !reloaded.count(desc.fragFilepath)) {
+            continue;
+        }
+
+        // A pipeline still on its first compile already picks up the previous module; it is not worth
+        // blocking the frame for, the next edit will rebuild it
+        if (!isReady(future)) {
+            continue;
+        }
+
+        try {
+            auto target = future.get();
+            auto replacement = _compiler.compile(
+                findShaderModule(desc.vertFilepath), findShaderModule(desc.fragFilepath), desc.configInfo);
+            _pendingReloads.push_back({std::move(target), std::move(replacement)});
+        } catch (const std::exception& e) {
+            std::cerr << "Unable to rebuild pipeline for " << desc.vertFilepath << " + " << desc.fragFilepath
+                      << ": " << e.what() << std::endl;
+        }
+    }
+}
+
+bool PipelineRegistry::applyReloads(uint64_t submittedFrameCount) {
+    std::lock_guard<std::mutex> lock{_mutex};
+
+    bool isChanged = false;
+    auto applyIfReady = [this, submittedFrameCount, &isChanged](PendingReload& reload) {
+        if (!isReady(reload.replacement)) {
+            return false;
+        }
+
+        try {
+            // After the swap the replacement object owns the old VkPipeline, which frames already
+            // submitted may still be executing
+            auto replacement = reload.replacement.get();
+            reload.target->swap(*replacement);
+            _retiredPipelines.push_back({std::move(replacement), submittedFrameCount});
+            isChanged = true;
+        } catch (const std::exception& e) {
+            std::cerr << "Pipeline rebuild failed, keeping the previous version: " << e.what() << std::endl;
+        }
+        return true;
+    };
+
+    _pendingReloads.erase(std::remove_if(_pendingReloads.begin(), _pendingReloads.end(), applyIfReady),
+                          _pendingReloads.end());
+
+    // Submitting frame N waited on the fence of frame N - MAX_FRAMES_IN_FLIGHT, so once that many frames
+    // were submitted after the swap, none of the frames that bound the old pipeline are still running
+    auto isIdle = [submittedFrameCount](const RetiredPipeline& retired) {
+        return submittedFrameCount >= retired.retiredAtFrame + SwapChain::MAX_FRAMES_IN_FLIGHT;
+    };
+
+    _retiredPipelines.erase(std::remove_if(_retiredPipelines.begin(), _retiredPipelines.end(), isIdle),
+                            _retiredPipelines.end());
+
+    return isChanged;
+}
+
+void PipelineRegistry::printStats() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    std::cout << "Pipeline registry: " << _pipelines.size() << " pipelines (" << _pipelineHits
+              << " reused), " << _shaderModules.size() << " shader modules (" << _shaderModuleHits
+              << " reused), " << _layoutCache.getLayoutCount() << " descriptor set layouts ("
+              << _layoutCache.getHitCount() << " reused), " << _pipelineLayoutCache.getLayoutCount()
+              << " pipeline layouts (" << _pipelineLayoutCache.getHitCount() << " reused)\n";
+}
+
+}  // namespace vge
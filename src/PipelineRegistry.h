@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Descriptor.h"
+#include "Device.h"
+#include "Pipeline.h"
+#include "PipelineCompiler.h"
+#include "ShaderBlobStore.h"
+#include "ShaderModule.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vge {
+
+// Hands out one pipeline per distinct PipelineDesc and one shader module per SPIR-V file, compiling
+// whatever is missing on the pipeline compiler, one descriptor set layout per binding signature and one
+// pipeline layout per list of set layouts and push constant ranges. Safe to use from several threads.
+class PipelineRegistry {
+public:
+    PipelineRegistry(Device& device, PipelineCompiler& compiler);
+
+    PipelineRegistry(const PipelineRegistry&) = delete;
+    PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+    PipelineCompiler::PipelineFuture getPipeline(const PipelineDesc& desc);
+    std::shared_ptr<ShaderModule> getShaderModule(const std::string& filepath);
+    inline ShaderBlobStore& getBlobStore() { return _blobStore; }
+    inline DescriptorLayoutCache& getLayoutCache() { return _layoutCache; }
+    // The pipeline layouts of descriptions passed to getPipeline must come from here
+    inline PipelineLayoutCache& getPipelineLayoutCache() { return _pipelineLayoutCache; }
+
+    // Hot reload, main thread only. Reloads the given SPIR-V files and rebuilds every pipeline using one of
+    // them in the background; the old pipelines stay in use until applyReloads swaps the new ones in.
+    void reloadShaders(const std::vector<std::string>& filepaths);
+    // Call between frames: swaps in finished rebuilds and destroys replaced pipelines once no frame in
+    // flight can still reference them. Returns true if any pipeline changed.
+    bool applyReloads(uint64_t submittedFrameCount);
+
+    void printStats();
+
+private:
+    struct DescHash {
+        size_t operator()(const PipelineDesc& desc) const { return desc.hash(); }
+    };
+
+    struct PendingReload {
+        std::shared_ptr<Pipeline> target;
+        PipelineCompiler::PipelineFuture replacement;
+    };
+
+    struct RetiredPipeline {
+        std::shared_ptr<Pipeline> pipeline;
+        uint64_t retiredAtFrame;
+    };
+
+    std::shared_ptr<ShaderModule> getShaderModuleLocked(const std::string& filepath);
+
+    Device& _device;
+    PipelineCompiler& _compiler;
+    ShaderBlobStore _blobStore;
+    DescriptorLayoutCache _layoutCache;
+    // Declared after the set layouts its layouts are made of
+    PipelineLayoutCache _pipelineLayoutCache;
+
+    std::mutex _mutex;
+    std::unordered_map<PipelineDesc, PipelineCompiler::PipelineFuture, DescHash> _pipelines;
+    std::unordered_map<std::string, std::shared_ptr<ShaderModule>> _shaderModules;
+    std::vector<PendingReload> _pendingReloads;
+    std::vector<RetiredPipeline> _retiredPipelines;
+    uint32_t _pipelineHits = 0;
+    uint32_t _shaderModuleHits = 0;
+};
+
+}  // namespace vge
@@ -0,0 +1,56 @@
+#include "RenderPassSignature.h"
+
+namespace vge {
+
+RenderPassSignature RenderPassSignature::fromCreateInfo(const VkRenderPassCreateInfo& createInfo) {
+    RenderPassSignature signature{};
+    auto& key = signature.key;
+
+    key.push_back(createInfo.flags);
+    key.push_back(createInfo.attachmentCount);
+    for (uint32_t i = 0; i < createInfo.attachmentCount; i++) {
+        const auto& attachment = createInfo.pAttachments[i];
+        key.push_back(attachment.flags);
+        key.push_back(attachment.format);
+        key.push_back(attachment.samples);
+    }
+
+    auto addReferences = [&key](uint32_t count, const VkAttachmentReference* references) {
+        key.push_back(count);
+        for (uint32_t i = 0; references != nullptr && i < count; i++) {
+            key.push_back(references[i].attachment);
+        }
+    };
+
+    key.push_back(createInfo.subpassCount);
+    for (uint32_t i = 0; i < createInfo.subpassCount; i++) {
+        const auto& subpass = createInfo.pSubpasses[i];
+        key.push_back(subpass.flags);
+        key.push_back(subpass.pipelineBindPoint);
+        addReferences(subpass.inputAttachmentCount, subpass.pInputAttachments);
+        addReferences(subpass.colorAttachmentCount, subpass.pColorAttachments);
+        addReferences(subpass.pResolveAttachments != nullptr ? subpass.colorAttachmentCount : 0,
+                      subpass.pResolveAttachments);
+        key.push_back(subpass.pDepthStencilAttachment != nullptr ? subpass.pDepthStencilAttachment->attachment
+                                                                 : VK_ATTACHMENT_UNUSED);
+        key.push_back(subpass.preserveAttachmentCount);
+        for (uint32_t j = 0; j < subpass.preserveAttachmentCount; j++) {
+            key.push_back(subpass.pPreserveAttachments[j]);
+        }
+    }
+
+    key.push_back(createInfo.dependencyCount);
+    for (uint32_t i = 0; i < createInfo.dependencyCount; i++) {
+        const auto& dependency = createInfo.pDependencies[i];
+        key.push_back(dependency.srcSubpass);
+        key.push_back(dependency.dstSubpass);
+        key.push_back(dependency.srcStageMask);
+        key.push_back(dependency.dstStageMask);
+        key.push_back(dependency.srcAccessMask);
+        key.push_back(dependency.dstAccessMask);
+        key.push_back(dependency.dependencyFlags);
+    }
+
+    return signature;
+}
+}  // namespace vge
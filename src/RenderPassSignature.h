@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace vge {
+
+// What decides whether a pipeline built for one render pass can be used with another: the attachments'
+// formats and sample counts, which attachments each subpass references and the dependencies between them.
+// Load and store ops and image layouts are left out, they don't affect compatibility.
+struct RenderPassSignature {
+    std::vector<uint64_t> key;
+
+    static RenderPassSignature fromCreateInfo(const VkRenderPassCreateInfo &createInfo);
+
+    inline bool operator==(const RenderPassSignature &other) const { return key == other.key; }
+    inline bool operator!=(const RenderPassSignature &other) const { return key != other.key; }
+};
+}  // namespace vge
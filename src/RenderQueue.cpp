@@ -0,0 +1,59 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+namespace vge {
+
+uint64_t RenderQueue::makeKey(
+    uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+    auto field = [](uint64_t value, uint32_t bits) { return value & ((uint64_t{1} << bits) - 1); };
+
+    const auto maxDepth = static_cast<float>((1u << DEPTH_BITS) - 1);
+    const auto depthBucket = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * maxDepth);
+
+    uint64_t key = field(pass, PASS_BITS);
+    key = (key << PIPELINE_BITS) | field(pipeline, PIPELINE_BITS);
+    key = (key << MATERIAL_BITS) | field(material, MATERIAL_BITS);
+    key = (key << MESH_BITS) | field(mesh, MESH_BITS);
+    key = (key << DEPTH_BITS) | depthBucket;
+    return key;
+}
+
+void RenderQueue::clear() { _items.clear(); }
+
+void RenderQueue::sort() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    _scratch.resize(_items.size());
+    for (uint32_t shift = 0; shift < 64 && _items.size() > 1; shift += 8) {
+        std::array<size_t, 256> offsets{};
+        for (const auto& item : _items) {
+            ++offsets[(item.key >> shift) & 0xFF];
+        }
+
+        // Every key has the same digit, the pass would not move anything
+        if (offsets[(_items.front().key >> shift) & 0xFF] == _items.size()) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (auto& count : offsets) {
+            size_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for (const auto& item : _items) {
+            _scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+        _items.swap(_scratch);
+    }
+
+    _sortTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                    std::chrono::high_resolution_clock::now() - start)
+                    .count();
+}
+
+}  // namespace vge
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vge {
+
+// Draws ordered by a 64-bit key, most significant field first:
+//
+//   | pass (4) | pipeline (12) | material (12) | mesh (16) | depth (20) |
+//
+// so everything sharing a pipeline, then a material, then a mesh ends up adjacent and each state change
+// happens once per frame. Within a mesh, draws run front to back for early depth rejection.
+class RenderQueue {
+public:
+    static constexpr uint32_t PASS_BITS = 4;
+    static constexpr uint32_t PIPELINE_BITS = 12;
+    static constexpr uint32_t MATERIAL_BITS = 12;
+    static constexpr uint32_t MESH_BITS = 16;
+    static constexpr uint32_t DEPTH_BITS = 20;
+    static_assert(PASS_BITS + PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64);
+
+    struct Item {
+        uint64_t key;
+        // Caller's index of the draw, e.g. into the frame's object list
+        uint32_t index;
+    };
+
+    // Fields wider than their bits are truncated. depth is normalized to [0, 1] and clamped.
+    static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+    void clear();
+    inline void push(uint64_t key, uint32_t index) { _items.push_back({key, index}); }
+
+    // LSD radix sort on 8-bit digits. Digits equal across all keys, such as unused fields, are skipped.
+    // Stable, so equal keys keep their push order.
+    void sort();
+
+    inline const std::vector<Item>& getItems() const { return _items; }
+    inline size_t size() const { return _items.size(); }
+    // Duration of the last sort call
+    inline float getSortTime() const { return _sortTime; }
+
+private:
+    std::vector<Item> _items;
+    std::vector<Item> _scratch;
+    float _sortTime = 0.0f;
+};
+
+}  // namespace vge
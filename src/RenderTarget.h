@@ -0,0 +1,54 @@
+#pragma once
+
+#include "GBuffer.h"
+#include "RenderPassSignature.h"
+
+#include <vulkan/vulkan.h>
+
+namespace vge {
+
+// Forward shades the scene straight into the color attachment in a single subpass. Deferred writes a G-buffer
+// in one subpass and accumulates lighting from it in a second, see GBuffer.
+enum class ShadingPath {
+    Forward,
+    Deferred,
+};
+
+// Depth buffer of a forward framebuffer, sampled between render passes
+struct DepthAttachment {
+    VkImage image;
+    VkImageView view;
+    VkFormat format;
+    VkExtent2D extent;
+};
+
+// Something the Renderer records frames into: the window swap chain or a set of offscreen images
+class RenderTarget {
+public:
+    virtual ~RenderTarget() = default;
+
+    virtual VkRenderPass getRenderPass() const = 0;
+    // Forward with depth sampling only: compatible with getRenderPass, but loads the attachments instead of
+    // clearing them, to continue a frame after leaving the render pass. Null otherwise.
+    virtual VkRenderPass getLoadRenderPass() const = 0;
+    // Of getRenderPass, pipelines are keyed on it rather than on the handle
+    virtual const RenderPassSignature &getRenderPassSignature() const = 0;
+    virtual VkFramebuffer getFrameBuffer(int index) const = 0;
+    virtual VkExtent2D getExtent() const = 0;
+    virtual ShadingPath getShadingPath() const = 0;
+    // Deferred only
+    virtual const GBuffer::Attachments &getGBufferAttachments(int index) const = 0;
+    // Forward only. Its contents survive the render pass only with depth sampling.
+    virtual DepthAttachment getDepthAttachment(int index) const = 0;
+
+    virtual VkResult acquireNextImage(uint32_t *imageIndex) = 0;
+    virtual VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) = 0;
+
+    // Called once the render pass has ended, while the frame's command buffer is still recording
+    virtual void recordFrameEnd(VkCommandBuffer commandBuffer, uint32_t imageIndex) {}
+
+    inline float extentAspectRatio() const {
+        return static_cast<float>(getExtent().width) / static_cast<float>(getExtent().height);
+    }
+};
+}  // namespace vge
@@ -1,14 +1,19 @@
 #include "Renderer.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <stdexcept>
 
 namespace vge {
 
-Renderer::Renderer(Window& window, Device& device)
-    : _window{window}
+Renderer::Renderer(Window& window, Device& device, ShadingPath shadingPath, bool depthSampling)
+    : _window{&window}
     , _device{device}
+    , _shadingPath{shadingPath}
+    , _depthSampling{depthSampling}
+    , _frameCount{0}
     , _currentImageIndex{0}
     , _currentFrameIndex{0}
     , _isFrameStarted{false} {
@@ -16,55 +21,97 @@ Renderer::Renderer(Window& window, Device& device)
     createCommandBuffers();
 }
 
+Renderer::Renderer(Device& device, VkExtent2D extent, ShadingPath shadingPath, bool depthSampling)
+    : _window{nullptr}
+    , _device{device}
+    , _shadingPath{shadingPath}
+    , _depthSampling{depthSampling}
+    , _offscreenTarget{std::make_unique<OffscreenTarget>(device, extent, shadingPath, depthSampling)}
+    , _frameCount{0}
+    , _currentImageIndex{0}
+    , _currentFrameIndex{0}
+    , _isFrameStarted{false} {
+    createCommandBuffers();
+}
+
 Renderer::~Renderer() { freeCommandBuffers(); }
 
 void Renderer::recreateSwapChain() {
-    auto extent = _window.getExtent();
+    auto extent = _window->getExtent();
     while (extent.width == 0 || extent.height == 0) {
-        extent = _window.getExtent();
+        extent = _window->getExtent();
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(_device.getVkDevice());
-
     if (_swapChain == nullptr) {
-        _swapChain = std::make_unique<SwapChain>(_device, extent);
-    } else {
-        std::shared_ptr<SwapChain> oldSwapChain = std::move(_swapChain);
-        _swapChain = std::make_unique<SwapChain>(_device, extent, oldSwapChain);
+        _swapChain = std::make_unique<SwapChain>(_device, extent, _shadingPath, _depthSampling);
+        return;
+    }
 
-        if (!oldSwapChain->compareSwapFormats(*_swapChain.get())) {
-            throw std::runtime_error("Swap chain image(or depth) format has changed!");
-        }
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // No vkDeviceWaitIdle here: frames already submitted keep running against the old swap chain,
+    // which is kept alive until the last frame that used it has completed
+    std::shared_ptr<SwapChain> oldSwapChain = std::move(_swapChain);
+    _swapChain = std::make_unique<SwapChain>(_device, extent, oldSwapChain);
+
+    if (!oldSwapChain->compareSwapFormats(*_swapChain.get())) {
+        throw std::runtime_error("Swap chain image(or depth) format has changed!");
     }
+
+    _retiredSwapChains.push_back({std::move(oldSwapChain), _frameCount});
+
+    auto elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                       std::chrono::high_resolution_clock::now() - start)
+                       .count();
+    ++_recreationStats.count;
+    _recreationStats.totalTime += elapsed;
+    _recreationStats.maxTime = std::max(_recreationStats.maxTime, elapsed);
+}
+
+void Renderer::releaseRetiredSwapChains() {
+    // The fence wait in acquireNextImage guarantees that frame (_frameCount - MAX_FRAMES_IN_FLIGHT) and
+    // everything before it has finished, so a swap chain whose last frame is older than that is idle
+    auto isIdle = [this](const RetiredSwapChain& retired) {
+        return _frameCount + 1 >= retired.retiredAtFrame + SwapChain::MAX_FRAMES_IN_FLIGHT;
+    };
+
+    _retiredSwapChains.erase(std::remove_if(_retiredSwapChains.begin(), _retiredSwapChains.end(), isIdle),
+                             _retiredSwapChains.end());
 }
 
 void Renderer::createCommandBuffers() {
+    _commandPools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
     _commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
 
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = _device.getCommandPool();
-    allocInfo.commandBufferCount = static_cast<uint32_t>(_commandBuffers.size());
+    for (size_t i = 0; i < _commandPools.size(); i++) {
+        _commandPools[i] = _device.createCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = _commandPools[i];
+        allocInfo.commandBufferCount = 1;
 
-    if (vkAllocateCommandBuffers(_device.getVkDevice(), &allocInfo, _commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate command buffers!");
+        if (vkAllocateCommandBuffers(_device.getVkDevice(), &allocInfo, &_commandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
     }
 }
 
 void Renderer::freeCommandBuffers() {
-    vkFreeCommandBuffers(_device.getVkDevice(),
-                         _device.getCommandPool(),
-                         static_cast<uint32_t>(_commandBuffers.size()),
-                         _commandBuffers.data());
+    // Destroying a pool frees every command buffer allocated from it
+    for (auto commandPool : _commandPools) {
+        vkDestroyCommandPool(_device.getVkDevice(), commandPool, nullptr);
+    }
+    _commandPools.clear();
     _commandBuffers.clear();
 }
 
 VkCommandBuffer Renderer::beginFrame() {
     assert(!_isFrameStarted && "Can't call beginFrame while already in progress");
 
-    auto result = _swapChain->acquireNextImage(&_currentImageIndex);
+    auto result = getRenderTarget().acquireNextImage(&_currentImageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
         return nullptr;
@@ -74,28 +121,44 @@ VkCommandBuffer Renderer::beginFrame() {
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
+    releaseRetiredSwapChains();
+
+    // acquireNextImage waited on this frame's fence, so nothing allocated from its pool is in use anymore
+    if (vkResetCommandPool(_device.getVkDevice(), _commandPools[_currentFrameIndex], 0) != VK_SUCCESS) {
+        throw std::runtime_error("failed to reset command pool!");
+    }
+
     _isFrameStarted = true;
 
     auto commandBuffer = getCurrentCommandBuffer();
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
+    _commandRecorder.begin(commandBuffer);
     return commandBuffer;
 }
 
 void Renderer::endFrame() {
     assert(_isFrameStarted && "Can't call endFrame while frame is not in progress");
     auto commandBuffer = getCurrentCommandBuffer();
+    getRenderTarget().recordFrameEnd(commandBuffer, _currentImageIndex);
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
     }
 
-    auto result = _swapChain->submitCommandBuffers(&commandBuffer, &_currentImageIndex);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _window.wasResized()) {
-        _window.resetWindowResizedFlag();
+    auto result = getRenderTarget().submitCommandBuffers(&commandBuffer, &_currentImageIndex);
+    ++_frameCount;
+
+    if (isHeadless()) {
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit offscreen frame!");
+        }
+    } else if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _window->wasResized()) {
+        _window->resetWindowResizedFlag();
         recreateSwapChain();
     } else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swap chain image!");
@@ -112,16 +175,18 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
 
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = _swapChain->getRenderPass();
-    renderPassInfo.framebuffer = _swapChain->getFrameBuffer(_currentImageIndex);
+    RenderTarget& target = getRenderTarget();
+    renderPassInfo.renderPass = target.getRenderPass();
+    renderPassInfo.framebuffer = target.getFrameBuffer(_currentImageIndex);
 
     renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = _swapChain->getSwapChainExtent();
+    renderPassInfo.renderArea.extent = target.getExtent();
 
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
-    clearValues[1].depthStencil = {1.0f, 0};
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    // Albedo and normals clear to zero, only the first two are used by the forward pass
+    std::array<VkClearValue, GBuffer::ATTACHMENT_COUNT> clearValues{};
+    clearValues[GBuffer::COLOR_ATTACHMENT].color = {0.01f, 0.01f, 0.01f, 1.0f};
+    clearValues[GBuffer::DEPTH_ATTACHMENT].depthStencil = {1.0f, 0};
+    renderPassInfo.clearValueCount = _shadingPath == ShadingPath::Deferred ? GBuffer::ATTACHMENT_COUNT : 2;
     renderPassInfo.pClearValues = clearValues.data();
 
     vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
@@ -129,16 +194,39 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(_swapChain->getSwapChainExtent().width);
-    viewport.height = static_cast<float>(_swapChain->getSwapChainExtent().height);
+    viewport.width = static_cast<float>(target.getExtent().width);
+    viewport.height = static_cast<float>(target.getExtent().height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     VkRect2D scissor{
         {0, 0},
-        _swapChain->getSwapChainExtent()
+        target.getExtent()
     };
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    _commandRecorder.setViewport(viewport);
+    _commandRecorder.setScissor(scissor);
+}
+
+void Renderer::resumeSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+    assert(_isFrameStarted && "Can't call resumeSwapChainRenderPass if frame is not in progress");
+    assert(_shadingPath == ShadingPath::Forward && _depthSampling &&
+           "Only the forward render pass with depth sampling can be resumed");
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    RenderTarget& target = getRenderTarget();
+    renderPassInfo.renderPass = target.getLoadRenderPass();
+    renderPassInfo.framebuffer = target.getFrameBuffer(_currentImageIndex);
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = target.getExtent();
+
+    // Viewport and scissor are command buffer state and outlive the previous render pass
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void Renderer::nextSubpass(VkCommandBuffer commandBuffer) {
+    assert(_isFrameStarted && "Can't call nextSubpass if frame is not in progress");
+    assert(_shadingPath == ShadingPath::Deferred && "Only the deferred render pass has a second subpass");
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 }
 
 void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
@@ -148,4 +236,15 @@ void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     vkCmdEndRenderPass(commandBuffer);
 }
 
+void Renderer::setFrameReadbackCallback(OffscreenTarget::ReadbackCallback callback) {
+    assert(isHeadless() && "Frame readback is only available for headless rendering");
+    _offscreenTarget->setReadbackCallback(std::move(callback));
+}
+
+void Renderer::flushFrameReadbacks() {
+    if (_offscreenTarget != nullptr) {
+        _offscreenTarget->flushReadbacks();
+    }
+}
+
 }  // namespace vge
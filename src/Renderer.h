@@ -1,6 +1,8 @@
 #pragma once
 
+#include "CommandRecorder.h"
 #include "Device.h"
+#include "OffscreenTarget.h"
 #include "SwapChain.h"
 #include "Window.h"
 
@@ -11,41 +13,112 @@
 namespace vge {
 class Renderer {
 public:
-    Renderer(Window& window, Device& device);
+    // Swap chains recreated after the first one, times in milliseconds
+    struct SwapChainRecreationStats {
+        uint32_t count;
+        float totalTime;
+        float maxTime;
+    };
+
+    // depthSampling keeps the forward depth buffer for sampling between render passes and enables
+    // resumeSwapChainRenderPass, see SwapChain
+    Renderer(Window& window,
+             Device& device,
+             ShadingPath shadingPath = ShadingPath::Forward,
+             bool depthSampling = false);
+    // Headless renderer drawing into offscreen images of the given size
+    Renderer(Device& device,
+             VkExtent2D extent,
+             ShadingPath shadingPath = ShadingPath::Forward,
+             bool depthSampling = false);
     ~Renderer();
 
     Renderer(const Renderer&) = delete;
     Renderer &operator=(const Renderer &) = delete;
 
-    inline VkRenderPass getSwapChainRenderPass() const { return _swapChain->getRenderPass(); }
-    inline float getAspectRatio() const { return _swapChain->extentAspectRatio(); }
+    inline VkRenderPass getSwapChainRenderPass() const { return getRenderTarget().getRenderPass(); }
+    inline const RenderPassSignature& getSwapChainRenderPassSignature() const {
+        return getRenderTarget().getRenderPassSignature();
+    }
+    inline float getAspectRatio() const { return getRenderTarget().extentAspectRatio(); }
+    inline bool isHeadless() const { return _window == nullptr; }
+    inline ShadingPath getShadingPath() const { return _shadingPath; }
     inline bool isFrameInProgress() const { return _isFrameStarted; }
+    inline uint64_t getSubmittedFrameCount() const { return _frameCount; }
+    inline const SwapChainRecreationStats& getSwapChainRecreationStats() const { return _recreationStats; }
 
     inline VkCommandBuffer getCurrentCommandBuffer() const {
         assert(_isFrameStarted && "Cannot get command buffer when frame not in progress");
         return _commandBuffers[_currentFrameIndex];
     }
 
+    // Tracks the state bound in the current command buffer, reset by beginFrame
+    inline CommandRecorder& getCommandRecorder() {
+        assert(_isFrameStarted && "Cannot get command recorder when frame not in progress");
+        return _commandRecorder;
+    }
+
     inline int getFrameIndex() const {
         assert(_isFrameStarted && "Cannot get frame index when frame not in progress");
         return _currentFrameIndex;
     }
 
+    inline VkExtent2D getExtent() const { return getRenderTarget().getExtent(); }
+
+    // Forward only: the depth buffer the current frame renders into
+    inline DepthAttachment getDepthAttachment() const {
+        assert(_isFrameStarted && "Cannot get depth attachment when frame not in progress");
+        return getRenderTarget().getDepthAttachment(static_cast<int>(_currentImageIndex));
+    }
+
+    // Deferred only: the G-buffer the current frame renders into
+    inline const GBuffer::Attachments& getGBufferAttachments() const {
+        assert(_isFrameStarted && "Cannot get G-buffer when frame not in progress");
+        return getRenderTarget().getGBufferAttachments(static_cast<int>(_currentImageIndex));
+    }
+
     VkCommandBuffer beginFrame();
     void endFrame();
     void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // Forward only: begins the render pass again after it was ended mid-frame, keeping what was drawn
+    void resumeSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // Deferred only: moves from the geometry to the lighting subpass
+    void nextSubpass(VkCommandBuffer commandBuffer);
     void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+    // Headless only: copies every finished frame back to host memory and hands it to the callback
+    void setFrameReadbackCallback(OffscreenTarget::ReadbackCallback callback);
+    void flushFrameReadbacks();
+
 private:
+    struct RetiredSwapChain {
+        std::shared_ptr<SwapChain> swapChain;
+        uint64_t retiredAtFrame;
+    };
+
     void createCommandBuffers();
     void freeCommandBuffers();
     void recreateSwapChain();
+    void releaseRetiredSwapChains();
+
+    inline RenderTarget& getRenderTarget() const {
+        return _swapChain != nullptr ? static_cast<RenderTarget&>(*_swapChain) : *_offscreenTarget;
+    }
 
-    Window& _window;
+    Window* _window;
     Device& _device;
+    ShadingPath _shadingPath;
+    bool _depthSampling;
     std::unique_ptr<SwapChain> _swapChain;
+    std::unique_ptr<OffscreenTarget> _offscreenTarget;
+    // One pool per frame in flight, reset as a whole once the frame's fence has signaled
+    std::vector<VkCommandPool> _commandPools;
     std::vector<VkCommandBuffer> _commandBuffers;
+    CommandRecorder _commandRecorder;
+    std::vector<RetiredSwapChain> _retiredSwapChains;
+    SwapChainRecreationStats _recreationStats{};
 
+    uint64_t _frameCount;
     uint32_t _currentImageIndex;
     int _currentFrameIndex;
     bool _isFrameStarted;
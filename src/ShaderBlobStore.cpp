@@ -0,0 +1,166 @@
+#include "ShaderBlobStore.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace vge {
+
+// Archive layout, all fields little-endian uint32:
+//   magic, version, entryCount
+//   per entry: nameLength, offset, size, name padded to 4 bytes
+//   SPIR-V blobs at the recorded offsets, each 4-byte aligned
+static constexpr uint32_t ARCHIVE_MAGIC = 0x4B505356;  // "VSPK"
+static constexpr uint32_t ARCHIVE_VERSION = 1;
+
+static size_t alignToWord(size_t size) { return (size + 3) & ~static_cast<size_t>(3); }
+
+ShaderBlob::ShaderBlob(std::shared_ptr<const Utils::MappedFile> file, const uint32_t* code, size_t size)
+    : _file{std::move(file)}
+    , _code{code}
+    , _size{size} {}
+
+std::shared_ptr<const ShaderBlob> ShaderBlob::map(const std::string& filepath) {
+    auto file = std::make_shared<const Utils::MappedFile>(filepath);
+    if (file->getSize() == 0 || file->getSize() % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("Invalid SPIR-V file size: " + filepath);
+    }
+
+    // Mappings are page aligned
+    const auto* code = static_cast<const uint32_t*>(file->getData());
+    return std::make_shared<const ShaderBlob>(file, code, file->getSize());
+}
+
+std::shared_ptr<const ShaderBlob> ShaderBlobStore::load(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock{_mutex};
+
+    std::error_code error;
+    auto modificationTime = std::filesystem::last_write_time(filepath, error);
+    const bool fileExists = !error;
+    if (!fileExists) {
+        modificationTime = std::filesystem::file_time_type::min();
+    }
+
+    auto it = _blobs.find(filepath);
+    if (it != _blobs.end() && it->second.modificationTime == modificationTime) {
+        return it->second.blob;
+    }
+
+    auto blob = findInArchive(filepath, modificationTime, fileExists);
+    if (blob == nullptr) {
+        if (!fileExists) {
+            throw std::runtime_error("Unable to open file: " + filepath);
+        }
+        blob = ShaderBlob::map(filepath);
+    }
+
+    _blobs[filepath] = {modificationTime, blob};
+    return blob;
+}
+
+std::shared_ptr<const ShaderBlob> ShaderBlobStore::findInArchive(
+    const std::string& filepath, std::filesystem::file_time_type modificationTime, bool fileExists) {
+    // A loose file edited after the archive was packed wins
+    if (_archiveBlobs.empty() || (fileExists && modificationTime > _archiveModificationTime)) {
+        return nullptr;
+    }
+
+    auto it = _archiveBlobs.find(std::filesystem::path(filepath).filename().string());
+    return it != _archiveBlobs.end() ? it->second : nullptr;
+}
+
+bool ShaderBlobStore::openArchive(const std::string& archivePath) {
+    std::error_code error;
+    auto modificationTime = std::filesystem::last_write_time(archivePath, error);
+    if (error) {
+        return false;
+    }
+
+    auto file = std::make_shared<const Utils::MappedFile>(archivePath);
+    const auto* words = static_cast<const uint32_t*>(file->getData());
+    const size_t wordCount = file->getSize() / sizeof(uint32_t);
+    if (wordCount < 3 || words[0] != ARCHIVE_MAGIC || words[1] != ARCHIVE_VERSION) {
+        throw std::runtime_error("Invalid shader archive: " + archivePath);
+    }
+
+    std::unordered_map<std::string, std::shared_ptr<const ShaderBlob>> blobs;
+    size_t position = 3;
+    for (uint32_t i = 0; i < words[2]; i++) {
+        if (position + 3 > wordCount) {
+            throw std::runtime_error("Truncated shader archive: " + archivePath);
+        }
+        const uint32_t nameLength = words[position];
+        const uint32_t offset = words[position + 1];
+        const uint32_t size = words[position + 2];
+        position += 3;
+
+        const size_t nameWords = alignToWord(nameLength) / sizeof(uint32_t);
+        if (position + nameWords > wordCount || offset % sizeof(uint32_t) != 0 ||
+            static_cast<size_t>(offset) + size > file->getSize()) {
+            throw std::runtime_error("Truncated shader archive: " + archivePath);
+        }
+        if (size == 0 || size % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("Invalid SPIR-V size in shader archive: " + archivePath);
+        }
+
+        std::string name(reinterpret_cast<const char*>(words + position), nameLength);
+        position += nameWords;
+
+        blobs[name] = std::make_shared<const ShaderBlob>(file, words + offset / sizeof(uint32_t), size);
+    }
+
+    std::lock_guard<std::mutex> lock{_mutex};
+    _archiveBlobs = std::move(blobs);
+    _archiveModificationTime = modificationTime;
+    _blobs.clear();
+
+    std::cout << "Shader archive " << archivePath << ": " << _archiveBlobs.size() << " shaders\n";
+    return true;
+}
+
+void ShaderBlobStore::writeArchive(const std::string& archivePath,
+                                   const std::vector<std::string>& filepaths) {
+    std::vector<std::shared_ptr<const ShaderBlob>> blobs;
+    std::vector<std::string> names;
+    size_t headerSize = 3 * sizeof(uint32_t);
+    for (const auto& filepath : filepaths) {
+        blobs.push_back(ShaderBlob::map(filepath));
+        names.push_back(std::filesystem::path(filepath).filename().string());
+        headerSize += 3 * sizeof(uint32_t) + alignToWord(names.back().size());
+    }
+
+    std::vector<uint32_t> header{ARCHIVE_MAGIC, ARCHIVE_VERSION, static_cast<uint32_t>(blobs.size())};
+    size_t offset = headerSize;
+    for (size_t i = 0; i < blobs.size(); i++) {
+        header.push_back(static_cast<uint32_t>(names[i].size()));
+        header.push_back(static_cast<uint32_t>(offset));
+        header.push_back(static_cast<uint32_t>(blobs[i]->getSize()));
+
+        std::vector<uint32_t> name(alignToWord(names[i].size()) / sizeof(uint32_t), 0);
+        std::memcpy(name.data(), names[i].data(), names[i].size());
+        header.insert(header.end(), name.begin(), name.end());
+
+        offset += blobs[i]->getSize();
+    }
+
+    // Same temp + rename dance as the pipeline cache, a crash never leaves a torn archive behind
+    const std::string tempPath = archivePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to open file: " + tempPath);
+        }
+
+        file.write(reinterpret_cast<const char*>(header.data()), header.size() * sizeof(uint32_t));
+        for (const auto& blob : blobs) {
+            file.write(reinterpret_cast<const char*>(blob->getCode()), blob->getSize());
+        }
+    }
+    std::filesystem::rename(tempPath, archivePath);
+
+    std::cout << "Packed " << blobs.size() << " shaders (" << offset << " bytes) into " << archivePath
+              << '\n';
+}
+
+}  // namespace vge
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vge {
+
+// SPIR-V words living in a mapped file, either a single .spv or a slice of a shader archive. The code
+// is 4-byte aligned, so it goes straight into VkShaderModuleCreateInfo::pCode without a copy.
+class ShaderBlob {
+public:
+    ShaderBlob(std::shared_ptr<const Utils::MappedFile> file, const uint32_t* code, size_t size);
+
+    // Maps a single .spv file, throws if it isn't a whole number of words
+    static std::shared_ptr<const ShaderBlob> map(const std::string& filepath);
+
+    inline const uint32_t* getCode() const { return _code; }
+    // In bytes
+    inline size_t getSize() const { return _size; }
+
+private:
+    std::shared_ptr<const Utils::MappedFile> _file;
+    const uint32_t* _code;
+    size_t _size;
+};
+
+// Hands out shader blobs, caching them by path and modification time so an unchanged file is mapped
+// once and an edited one (hot reload) is picked up. An optional archive packs every .spv into a single
+// file that is opened and mapped once at startup. Safe to use from several threads.
+class ShaderBlobStore {
+public:
+    static constexpr const char* ARCHIVE_PATH = "../shaders/shaders.pak";
+
+    ShaderBlobStore() = default;
+
+    ShaderBlobStore(const ShaderBlobStore&) = delete;
+    ShaderBlobStore& operator=(const ShaderBlobStore&) = delete;
+
+    std::shared_ptr<const ShaderBlob> load(const std::string& filepath);
+
+    // Serves blobs from the archive for files that are missing or not newer than the archive itself.
+    // Returns false if there is no archive at the path.
+    bool openArchive(const std::string& archivePath = ARCHIVE_PATH);
+
+    // Packs the given .spv files into an archive, each entry keyed by its file name
+    static void writeArchive(const std::string& archivePath, const std::vector<std::string>& filepaths);
+
+private:
+    struct CachedBlob {
+        std::filesystem::file_time_type modificationTime;
+        std::shared_ptr<const ShaderBlob> blob;
+    };
+
+    std::shared_ptr<const ShaderBlob> findInArchive(const std::string& filepath,
+                                                    std::filesystem::file_time_type modificationTime,
+                                                    bool fileExists);
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, CachedBlob> _blobs;
+
+    std::unordered_map<std::string, std::shared_ptr<const ShaderBlob>> _archiveBlobs;
+    std::filesystem::file_time_type _archiveModificationTime;
+};
+
+}  // namespace vge
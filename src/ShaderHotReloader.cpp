@@ -0,0 +1,109 @@
+#include "ShaderHotReloader.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// Set by CMake to the glslc found for the Shaders target
+#ifndef VGE_GLSLC_PATH
+#define VGE_GLSLC_PATH "glslc"
+#endif
+
+namespace vge {
+
+static constexpr auto WATCH_INTERVAL = std::chrono::milliseconds(250);
+
+ShaderHotReloader::ShaderHotReloader(const std::string& shaderDirectory)
+    : _shaderDirectory{shaderDirectory}
+    , _isStopping{false} {
+    // Remember the current state so that only edits made from now on trigger a recompile
+    scan(false);
+    _thread = std::thread(&ShaderHotReloader::watchLoop, this);
+
+    std::cout << "Watching " << _shaderDirectory << " for shader changes" << std::endl;
+}
+
+ShaderHotReloader::~ShaderHotReloader() {
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _isStopping = true;
+    }
+    _condition.notify_all();
+    _thread.join();
+}
+
+std::vector<std::string> ShaderHotReloader::takeRecompiledShaders() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return std::move(_recompiledShaders);
+}
+
+void ShaderHotReloader::watchLoop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            if (_condition.wait_for(lock, WATCH_INTERVAL, [this]() { return _isStopping; })) {
+                return;
+            }
+        }
+        scan(true);
+    }
+}
+
+void ShaderHotReloader::scan(bool compileChanges) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(_shaderDirectory, error)) {
+        const auto& sourcePath = entry.path();
+        if (sourcePath.extension() != ".vert" && sourcePath.extension() != ".frag") {
+            continue;
+        }
+
+        auto timestamp = std::filesystem::last_write_time(sourcePath, error);
+        if (error) {
+            continue;
+        }
+
+        auto name = sourcePath.filename().string();
+        auto it = _timestamps.find(name);
+        bool isChanged = it == _timestamps.end() || it->second != timestamp;
+        _timestamps[name] = timestamp;
+
+        if (!compileChanges || !isChanged) {
+            continue;
+        }
+
+        const std::string spvPath = _shaderDirectory + "/" + name + ".spv";
+        if (compile(sourcePath, spvPath)) {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _recompiledShaders.push_back(spvPath);
+        }
+    }
+}
+
+bool ShaderHotReloader::compile(const std::filesystem::path& sourcePath, const std::string& spvPath) {
+    // glslc writes to a temporary file that is renamed over the old SPIR-V, so a pipeline being built
+    // concurrently never reads a half-written file
+    const std::string tempPath = spvPath + ".tmp";
+    const std::string command =
+        std::string("\"") + VGE_GLSLC_PATH + "\" \"" + sourcePath.string() + "\" -o \"" + tempPath + "\"";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (std::system(command.c_str()) != 0) {
+        std::cerr << "Shader compilation failed, keeping the previous version of " << spvPath << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, spvPath, error);
+    if (error) {
+        std::cerr << "Unable to replace " << spvPath << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    auto elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                       std::chrono::high_resolution_clock::now() - start)
+                       .count();
+    std::cout << "Recompiled " << sourcePath.filename().string() << " in " << elapsed << "ms" << std::endl;
+    return true;
+}
+
+}  // namespace vge
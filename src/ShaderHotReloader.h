@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vge {
+
+// Development helper: watches the GLSL sources and recompiles changed ones to SPIR-V with glslc on a
+// background thread. The resulting .spv paths are picked up on the main thread at a frame boundary.
+class ShaderHotReloader {
+public:
+    // Same location the pipelines load their SPIR-V from
+    static constexpr const char* SHADER_DIRECTORY = "../shaders";
+
+    explicit ShaderHotReloader(const std::string& shaderDirectory = SHADER_DIRECTORY);
+    ~ShaderHotReloader();
+
+    ShaderHotReloader(const ShaderHotReloader&) = delete;
+    ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+    // SPIR-V files successfully recompiled since the last call, in the form "../shaders/x.vert.spv"
+    std::vector<std::string> takeRecompiledShaders();
+
+private:
+    void watchLoop();
+    void scan(bool compileChanges);
+    bool compile(const std::filesystem::path& sourcePath, const std::string& spvPath);
+
+private:
+    std::string _shaderDirectory;
+    std::unordered_map<std::string, std::filesystem::file_time_type> _timestamps;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _isStopping;
+    std::vector<std::string> _recompiledShaders;
+
+    std::thread _thread;
+};
+
+}  // namespace vge
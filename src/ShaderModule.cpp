@@ -0,0 +1,32 @@
+#include "ShaderModule.h"
+
+#include <stdexcept>
+
+namespace vge {
+
+ShaderModule::ShaderModule(Device& device, const std::string& filepath)
+    : ShaderModule(device, filepath, *ShaderBlob::map(filepath)) {}
+
+ShaderModule::ShaderModule(Device& device, const std::string& filepath, const ShaderBlob& code)
+    : _device{device}
+    , _filepath{filepath} {
+    createShaderModule(code);
+}
+
+ShaderModule::~ShaderModule() { vkDestroyShaderModule(_device.getVkDevice(), _shaderModule, nullptr); }
+
+void ShaderModule::createShaderModule(const ShaderBlob& code) {
+    // Straight from the mapped file, no copy
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.getSize();
+    createInfo.pCode = code.getCode();
+
+    _reflection = ShaderReflection::reflect(code.getCode(), code.getSize() / sizeof(uint32_t));
+
+    if (vkCreateShaderModule(_device.getVkDevice(), &createInfo, nullptr, &_shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module");
+    }
+}
+
+}  // namespace vge
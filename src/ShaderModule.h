@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Device.h"
+#include "ShaderBlobStore.h"
+#include "ShaderReflection.h"
+
+#include <string>
+#include <vector>
+
+namespace vge {
+
+// A compiled SPIR-V file wrapped in a VkShaderModule. Pipelines hold these through shared pointers,
+// so every pipeline using the same file shares one module.
+class ShaderModule {
+public:
+    // Maps the file itself, bypassing any blob cache
+    ShaderModule(Device& device, const std::string& filepath);
+    ShaderModule(Device& device, const std::string& filepath, const ShaderBlob& code);
+    ~ShaderModule();
+
+    ShaderModule(const ShaderModule&) = delete;
+    ShaderModule& operator=(const ShaderModule&) = delete;
+
+    inline VkShaderModule getShaderModule() const { return _shaderModule; }
+    inline const std::string& getFilepath() const { return _filepath; }
+    inline const ShaderReflection& getReflection() const { return _reflection; }
+
+private:
+    void createShaderModule(const ShaderBlob& code);
+
+private:
+    Device& _device;
+    std::string _filepath;
+    VkShaderModule _shaderModule;
+    ShaderReflection _reflection;
+};
+
+}  // namespace vge
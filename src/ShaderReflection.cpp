@@ -0,0 +1,208 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace vge {
+
+namespace {
+
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+enum Op : uint32_t {
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+    OpTypeBool = 20,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeArray = 28,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpSpecConstant = 50,
+    OpVariable = 59,
+};
+
+enum Decoration : uint32_t {
+    DecorationArrayStride = 6,
+    DecorationMatrixStride = 7,
+    DecorationBuiltIn = 11,
+    DecorationLocation = 30,
+    DecorationOffset = 35,
+};
+
+enum StorageClass : uint32_t {
+    StorageClassInput = 1,
+    StorageClassPushConstant = 9,
+};
+
+struct Type {
+    uint32_t opcode = 0;
+    // Scalars: bit width and signedness. Vectors/matrices/arrays/pointers: element type and count.
+    uint32_t width = 0;
+    bool isSigned = false;
+    uint32_t elementType = 0;
+    uint32_t count = 0;
+    std::vector<uint32_t> members;
+};
+
+struct Module {
+    std::unordered_map<uint32_t, Type> types;
+    std::unordered_map<uint32_t, uint32_t> constants;
+    std::unordered_map<uint32_t, uint32_t> locations;
+    std::unordered_map<uint32_t, uint32_t> arrayStrides;
+    std::unordered_map<uint64_t, uint32_t> memberOffsets;
+    std::unordered_map<uint64_t, uint32_t> memberMatrixStrides;
+    std::vector<uint32_t> builtIns;
+
+    static uint64_t memberKey(uint32_t structType, uint32_t member) {
+        return (static_cast<uint64_t>(structType) << 32) | member;
+    }
+
+    const Type& type(uint32_t id) const {
+        auto it = types.find(id);
+        if (it == types.end()) {
+            throw std::runtime_error("failed to reflect shader: unknown type id!");
+        }
+        return it->second;
+    }
+
+    // std140/std430 sizes as laid out by the decorations, which is what push constant ranges must cover
+    uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride = 0) const {
+        const Type& t = type(typeId);
+        switch (t.opcode) {
+            case OpTypeBool: return 4;
+            case OpTypeInt:
+            case OpTypeFloat: return t.width / 8;
+            case OpTypeVector: return t.count * sizeOf(t.elementType);
+            case OpTypeMatrix: return t.count * (matrixStride != 0 ? matrixStride : sizeOf(t.elementType));
+            case OpTypeArray: {
+                auto stride = arrayStrides.find(typeId);
+                uint32_t elementSize = stride != arrayStrides.end() ? stride->second : sizeOf(t.elementType);
+                auto length = constants.find(t.count);
+                return elementSize * (length != constants.end() ? length->second : 0);
+            }
+            case OpTypeStruct: {
+                uint32_t size = 0;
+                for (uint32_t i = 0; i < t.members.size(); i++) {
+                    auto offset = memberOffsets.find(memberKey(typeId, i));
+                    auto stride = memberMatrixStrides.find(memberKey(typeId, i));
+                    uint32_t memberSize =
+                        sizeOf(t.members[i], stride != memberMatrixStrides.end() ? stride->second : 0);
+                    size = std::max(size, (offset != memberOffsets.end() ? offset->second : 0) + memberSize);
+                }
+                return size;
+            }
+            default: throw std::runtime_error("failed to reflect shader: unsupported type in interface!");
+        }
+    }
+};
+
+}  // namespace
+
+ShaderReflection ShaderReflection::reflect(const uint32_t* code, size_t wordCount) {
+    if (wordCount < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) {
+        throw std::runtime_error("failed to reflect shader: not a SPIR-V module!");
+    }
+
+    Module module;
+    std::vector<std::pair<uint32_t, uint32_t>> variables;  // (pointer type, id) of interface variables
+
+    for (size_t i = SPIRV_HEADER_WORDS; i < wordCount;) {
+        const uint32_t opcode = code[i] & 0xFFFF;
+        const uint32_t length = code[i] >> 16;
+        if (length == 0 || i + length > wordCount) {
+            throw std::runtime_error("failed to reflect shader: truncated instruction!");
+        }
+        const uint32_t* operands = code + i + 1;
+
+        switch (opcode) {
+            case OpDecorate:
+                if (operands[1] == DecorationLocation) {
+                    module.locations[operands[0]] = operands[2];
+                } else if (operands[1] == DecorationArrayStride) {
+                    module.arrayStrides[operands[0]] = operands[2];
+                } else if (operands[1] == DecorationBuiltIn) {
+                    module.builtIns.push_back(operands[0]);
+                }
+                break;
+            case OpMemberDecorate:
+                if (operands[2] == DecorationOffset) {
+                    module.memberOffsets[Module::memberKey(operands[0], operands[1])] = operands[3];
+                } else if (operands[2] == DecorationMatrixStride) {
+                    module.memberMatrixStrides[Module::memberKey(operands[0], operands[1])] = operands[3];
+                }
+                break;
+            case OpTypeBool: module.types[operands[0]] = {opcode}; break;
+            case OpTypeInt: module.types[operands[0]] = {opcode, operands[1], operands[2] != 0}; break;
+            case OpTypeFloat: module.types[operands[0]] = {opcode, operands[1]}; break;
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeArray: module.types[operands[0]] = {opcode, 0, false, operands[1], operands[2]}; break;
+            case OpTypeStruct:
+                module.types[operands[0]] = {opcode, 0, false, 0, 0, {operands + 1, operands + length - 1}};
+                break;
+            case OpTypePointer:
+                // Storage class goes in count, pointee in elementType
+                module.types[operands[0]] = {opcode, 0, false, operands[2], operands[1]};
+                break;
+            case OpConstant:
+            case OpSpecConstant: module.constants[operands[1]] = operands[2]; break;
+            case OpVariable:
+                if (operands[2] == StorageClassInput || operands[2] == StorageClassPushConstant) {
+                    variables.emplace_back(operands[0], operands[1]);
+                }
+                break;
+        }
+        i += length;
+    }
+
+    ShaderReflection reflection;
+    for (const auto& [pointerType, id] : variables) {
+        const Type& pointer = module.type(pointerType);
+        if (pointer.count == StorageClassPushConstant) {
+            reflection.pushConstantSize = module.sizeOf(pointer.elementType);
+            continue;
+        }
+
+        auto location = module.locations.find(id);
+        if (location == module.locations.end() ||
+            std::find(module.builtIns.begin(), module.builtIns.end(), id) != module.builtIns.end()) {
+            continue;
+        }
+
+        // A matrix input takes one location per column
+        const Type* type = &module.type(pointer.elementType);
+        uint32_t locationCount = 1;
+        if (type->opcode == OpTypeMatrix) {
+            locationCount = type->count;
+            type = &module.type(type->elementType);
+        }
+
+        uint32_t componentCount = 1;
+        if (type->opcode == OpTypeVector) {
+            componentCount = type->count;
+            type = &module.type(type->elementType);
+        }
+
+        auto componentType = VertexFormatInfo::ComponentType::Unknown;
+        if (type->opcode == OpTypeFloat) {
+            componentType = VertexFormatInfo::ComponentType::Float;
+        } else if (type->opcode == OpTypeInt) {
+            componentType =
+                type->isSigned ? VertexFormatInfo::ComponentType::SInt : VertexFormatInfo::ComponentType::UInt;
+        }
+
+        for (uint32_t i = 0; i < locationCount; i++) {
+            reflection.inputs.push_back({location->second + i, componentType, componentCount});
+        }
+    }
+
+    return reflection;
+}
+
+}  // namespace vge
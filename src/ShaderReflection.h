@@ -0,0 +1,29 @@
+#pragma once
+
+#include "VertexLayout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vge {
+
+// The parts of a SPIR-V module's interface that pipelines are validated against, read straight from the
+// binary. Only what the engine's shaders use is understood: scalar and vector stage inputs and a single
+// push constant block.
+struct ShaderReflection {
+    struct Input {
+        uint32_t location;
+        VertexFormatInfo::ComponentType componentType;
+        uint32_t componentCount;
+    };
+
+    // User-defined stage inputs, built-ins excluded
+    std::vector<Input> inputs;
+    // Bytes of the push constant block actually declared by the shader, 0 if it has none
+    uint32_t pushConstantSize = 0;
+
+    static ShaderReflection reflect(const uint32_t* code, size_t wordCount);
+};
+
+}  // namespace vge
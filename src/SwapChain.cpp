@@ -10,14 +10,18 @@
 
 namespace vge {
 
-SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent)
-    : _device{deviceRef}
+SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent, ShadingPath shadingPath, bool depthSampling)
+    : _shadingPath{shadingPath}
+    , _depthSampling{depthSampling}
+    , _device{deviceRef}
     , _windowExtent{extent} {
     init();
 }
 
 SwapChain::SwapChain(Device &deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous)
-    : _device{deviceRef}
+    : _shadingPath{previous->_shadingPath}
+    , _depthSampling{previous->_depthSampling}
+    , _device{deviceRef}
     , _windowExtent{extent}
     , _oldSwapChain{previous} {
     init();
@@ -30,7 +34,12 @@ void SwapChain::init() {
     createRenderPass();
     createDepthResources();
     createFramebuffers();
-    createSyncObjects();
+
+    if (_oldSwapChain != nullptr) {
+        adoptSyncObjects(*_oldSwapChain);
+    } else {
+        createSyncObjects();
+    }
 }
 
 SwapChain::~SwapChain() {
@@ -55,9 +64,10 @@ SwapChain::~SwapChain() {
     }
 
     vkDestroyRenderPass(_device.getVkDevice(), _renderPass, nullptr);
+    vkDestroyRenderPass(_device.getVkDevice(), _loadRenderPass, nullptr);
 
-    // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    // cleanup synchronization objects (empty if they were handed over to a newer swap chain)
+    for (size_t i = 0; i < _inFlightFences.size(); i++) {
         vkDestroySemaphore(_device.getVkDevice(), _renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(_device.getVkDevice(), _imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(_device.getVkDevice(), _inFlightFences[i], nullptr);
@@ -207,14 +217,36 @@ void SwapChain::createImageViews() {
 }
 
 void SwapChain::createRenderPass() {
+    if (_shadingPath == ShadingPath::Deferred) {
+        _renderPass = GBuffer::createRenderPass(_device,
+                                                getSwapChainImageFormat(),
+                                                VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                                findDepthFormat(),
+                                                _renderPassSignature);
+        return;
+    }
+
+    _renderPass = createForwardRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR);
+    if (_depthSampling) {
+        _loadRenderPass = createForwardRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD);
+    }
+}
+
+VkRenderPass SwapChain::createForwardRenderPass(VkAttachmentLoadOp loadOp) {
+    // Loading continues a frame whose first render pass left the attachments in their final layouts
+    const bool load = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+
     VkAttachmentDescription depthAttachment{};
     depthAttachment.format = findDepthFormat();
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.loadOp = loadOp;
+    // Stored for the depth pyramid and for a render pass that loads it, otherwise it can stay on chip
+    depthAttachment.storeOp =
+        _depthSampling ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.initialLayout =
+        load ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
     depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference depthAttachmentRef{};
@@ -224,11 +256,11 @@ void SwapChain::createRenderPass() {
     VkAttachmentDescription colorAttachment = {};
     colorAttachment.format = getSwapChainImageFormat();
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.loadOp = loadOp;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.initialLayout = load ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED;
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentRef = {};
@@ -251,6 +283,12 @@ void SwapChain::createRenderPass() {
     dependency.srcAccessMask = 0;
     dependency.srcStageMask =
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    if (load) {
+        // Color written by the frame's previous render pass, which blending reads back. Depth is handed over
+        // by the barrier that returns it from sampling.
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+    }
 
     std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
     VkRenderPassCreateInfo renderPassInfo = {};
@@ -262,15 +300,31 @@ void SwapChain::createRenderPass() {
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(_device.getVkDevice(), &renderPassInfo, nullptr, &_renderPass) != VK_SUCCESS) {
+    // The variant that loads is compatible, pipelines are built for the one that clears
+    if (!load) {
+        _renderPassSignature = RenderPassSignature::fromCreateInfo(renderPassInfo);
+    }
+
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(_device.getVkDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
+    return renderPass;
 }
 
 void SwapChain::createFramebuffers() {
     _swapChainFramebuffers.resize(imageCount());
     for (size_t i = 0; i < imageCount(); i++) {
-        std::array<VkImageView, 2> attachments = {_swapChainImageViews[i], _depthImageViews[i]};
+        std::vector<VkImageView> attachments;
+        if (_shadingPath == ShadingPath::Deferred) {
+            const auto &gBufferAttachments = _gBuffer->getAttachments(i);
+            attachments = {_swapChainImageViews[i],
+                           gBufferAttachments.depth,
+                           gBufferAttachments.albedo,
+                           gBufferAttachments.normal};
+        } else {
+            attachments = {_swapChainImageViews[i], _depthImageViews[i]};
+        }
 
         VkExtent2D swapChainExtent = getSwapChainExtent();
         VkFramebufferCreateInfo framebufferInfo = {};
@@ -294,6 +348,11 @@ void SwapChain::createDepthResources() {
     _swapChainDepthFormat = depthFormat;
     VkExtent2D swapChainExtent = getSwapChainExtent();
 
+    if (_shadingPath == ShadingPath::Deferred) {
+        _gBuffer = std::make_unique<GBuffer>(_device, swapChainExtent, depthFormat, imageCount());
+        return;
+    }
+
     _depthImages.resize(imageCount());
     _depthImageMemorys.resize(imageCount());
     _depthImageViews.resize(imageCount());
@@ -311,6 +370,10 @@ void SwapChain::createDepthResources() {
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        // Sampled to build the depth pyramid for occlusion culling
+        if (_depthSampling) {
+            imageInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        }
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.flags = 0;
@@ -359,6 +422,22 @@ void SwapChain::createSyncObjects() {
     }
 }
 
+// Frame sync objects outlive the swap chain so that frames still in flight on the previous swap chain
+// keep being waited on through the same fences and nothing has to drain the device on recreation
+void SwapChain::adoptSyncObjects(SwapChain &previous) {
+    _imageAvailableSemaphores = std::move(previous._imageAvailableSemaphores);
+    _renderFinishedSemaphores = std::move(previous._renderFinishedSemaphores);
+    _inFlightFences = std::move(previous._inFlightFences);
+    _currentFrame = previous._currentFrame;
+
+    previous._imageAvailableSemaphores.clear();
+    previous._renderFinishedSemaphores.clear();
+    previous._inFlightFences.clear();
+    previous._imagesInFlight.clear();
+
+    _imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+}
+
 VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(
     const std::vector<VkSurfaceFormatKHR> &availableFormats) {
     for (const auto &availableFormat : availableFormats) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Device.h"
+#include "RenderTarget.h"
 
 #include <vulkan/vulkan.h>
 
@@ -10,11 +11,17 @@
 
 namespace vge {
 
-class SwapChain {
+class SwapChain : public RenderTarget {
 public:
     static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-    SwapChain(Device &deviceRef, VkExtent2D windowExtent);
+    // Forward only: depthSampling stores the depth buffer and makes it sampleable, and creates the load
+    // render pass, for GPU occlusion culling. Without it depth never leaves the render pass.
+    SwapChain(Device &deviceRef,
+              VkExtent2D windowExtent,
+              ShadingPath shadingPath = ShadingPath::Forward,
+              bool depthSampling = false);
+    // Keeps the previous swap chain's shading path and depth sampling
     SwapChain(Device &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
 
     ~SwapChain();
@@ -22,8 +29,18 @@ public:
     SwapChain(const SwapChain &) = delete;
     SwapChain &operator=(const SwapChain &) = delete;
 
-    inline VkFramebuffer getFrameBuffer(int index) const { return _swapChainFramebuffers[index]; }
-    inline VkRenderPass getRenderPass() const { return _renderPass; }
+    inline VkFramebuffer getFrameBuffer(int index) const override { return _swapChainFramebuffers[index]; }
+    inline VkRenderPass getRenderPass() const override { return _renderPass; }
+    inline VkRenderPass getLoadRenderPass() const override { return _loadRenderPass; }
+    inline const RenderPassSignature &getRenderPassSignature() const override { return _renderPassSignature; }
+    inline VkExtent2D getExtent() const override { return _swapChainExtent; }
+    inline ShadingPath getShadingPath() const override { return _shadingPath; }
+    inline const GBuffer::Attachments &getGBufferAttachments(int index) const override {
+        return _gBuffer->getAttachments(index);
+    }
+    inline DepthAttachment getDepthAttachment(int index) const override {
+        return {_depthImages[index], _depthImageViews[index], _swapChainDepthFormat, _swapChainExtent};
+    }
     inline VkImageView getImageView(int index) const { return _swapChainImageViews[index]; }
     inline size_t imageCount() const { return _swapChainImages.size(); }
     inline VkFormat getSwapChainImageFormat() const { return _swapChainImageFormat; }
@@ -31,14 +48,10 @@ public:
     inline uint32_t width() const { return _swapChainExtent.width; }
     inline uint32_t height() const { return _swapChainExtent.height; }
 
-    inline float extentAspectRatio() const {
-        return static_cast<float>(_swapChainExtent.width) / static_cast<float>(_swapChainExtent.height);
-    }
-
     VkFormat findDepthFormat();
 
-    VkResult acquireNextImage(uint32_t *imageIndex);
-    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+    VkResult acquireNextImage(uint32_t *imageIndex) override;
+    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) override;
 
     inline bool compareSwapFormats(const SwapChain &swapChain) const {
         return swapChain._swapChainDepthFormat == _swapChainDepthFormat &&
@@ -51,8 +64,10 @@ private:
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
+    VkRenderPass createForwardRenderPass(VkAttachmentLoadOp loadOp);
     void createFramebuffers();
     void createSyncObjects();
+    void adoptSyncObjects(SwapChain &previous);
 
     // Helper functions
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &availableFormats);
@@ -60,13 +75,20 @@ private:
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
 private:
+    ShadingPath _shadingPath;
+    bool _depthSampling;
     VkFormat _swapChainImageFormat;
     VkFormat _swapChainDepthFormat;
     VkExtent2D _swapChainExtent;
 
     std::vector<VkFramebuffer> _swapChainFramebuffers;
     VkRenderPass _renderPass;
+    RenderPassSignature _renderPassSignature;
+    // Forward only
+    VkRenderPass _loadRenderPass = VK_NULL_HANDLE;
 
+    // Deferred only, replaces the depth images
+    std::unique_ptr<GBuffer> _gBuffer;
     std::vector<VkImage> _depthImages;
     std::vector<VkDeviceMemory> _depthImageMemorys;
     std::vector<VkImageView> _depthImageViews;
@@ -0,0 +1,44 @@
+#include "ThreadPool.h"
+
+namespace vge {
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : _isStopping{false} {
+    _workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        _workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _isStopping = true;
+    }
+    _condition.notify_all();
+
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _condition.wait(lock, [this]() { return _isStopping || !_jobs.empty(); });
+
+            // Jobs queued before shutdown still run so that no future is left without a result
+            if (_jobs.empty()) {
+                return;
+            }
+
+            job = std::move(_jobs.front());
+            _jobs.pop();
+        }
+        job();
+    }
+}
+
+}  // namespace vge
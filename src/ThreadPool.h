@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vge {
+
+// Fixed set of worker threads executing submitted jobs in FIFO order
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    inline size_t getThreadCount() const { return _workers.size(); }
+
+    // Exceptions thrown by the job are rethrown from the returned future's get()
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F &&job) {
+        using Result = std::invoke_result_t<F>;
+
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _jobs.emplace([task]() { (*task)(); });
+        }
+        _condition.notify_one();
+
+        return result;
+    }
+
+private:
+    void workerLoop();
+
+private:
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _isStopping;
+};
+
+}  // namespace vge
@@ -1,6 +1,18 @@
 #include "Utils.h"
 
 #include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace vge {
 namespace Utils {
@@ -8,7 +20,7 @@ std::vector<char> readFile(const std::string& filepath) {
     std::ifstream file(filepath, std::ios::ate | std::ios::binary);
 
     if (!file.is_open()) {
-        throw std::runtime_error("Unable to open shader file: " + filepath);
+        throw std::runtime_error("Unable to open file: " + filepath);
     }
 
     size_t fileSize = static_cast<size_t>(file.tellg());
@@ -21,5 +33,101 @@ std::vector<char> readFile(const std::string& filepath) {
 
     return buffer;
 }
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& filepath) {
+    _fileHandle = CreateFileA(filepath.c_str(),
+                              GENERIC_READ,
+                              // Lets a rebuilt shader or repacked archive replace the file while it is mapped
+                              FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (_fileHandle == INVALID_HANDLE_VALUE) {
+        _fileHandle = nullptr;
+        throw std::runtime_error("Unable to open file: " + filepath);
+    }
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(_fileHandle, &size);
+    _size = static_cast<size_t>(size.QuadPart);
+    // Empty files can't be mapped
+    if (_size == 0) {
+        return;
+    }
+
+    _mappingHandle = CreateFileMappingA(_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    _data = _mappingHandle != nullptr ? MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (_data == nullptr) {
+        if (_mappingHandle != nullptr) {
+            CloseHandle(_mappingHandle);
+        }
+        CloseHandle(_fileHandle);
+        throw std::runtime_error("Unable to map file: " + filepath);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (_data != nullptr) {
+        UnmapViewOfFile(_data);
+        CloseHandle(_mappingHandle);
+    }
+    CloseHandle(_fileHandle);
+}
+#else
+MappedFile::MappedFile(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open file: " + filepath);
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Unable to stat file: " + filepath);
+    }
+    _size = static_cast<size_t>(info.st_size);
+
+    // Empty files can't be mapped. The mapping keeps the file referenced, so the descriptor can go.
+    if (_size != 0) {
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Unable to map file: " + filepath);
+        }
+        _data = data;
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (_data != nullptr) {
+        munmap(const_cast<void*>(_data), _size);
+    }
+}
+#endif
+
+void writeImagePPM(const std::string& filepath, const void* rgbaPixels, uint32_t width, uint32_t height) {
+    std::ofstream file(filepath, std::ios::binary);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open image file: " + filepath);
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    const auto* pixels = static_cast<const uint8_t*>(rgbaPixels);
+    std::vector<char> row(static_cast<size_t>(width) * 3);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const uint8_t* pixel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+            row[x * 3 + 0] = static_cast<char>(pixel[0]);
+            row[x * 3 + 1] = static_cast<char>(pixel[1]);
+            row[x * 3 + 2] = static_cast<char>(pixel[2]);
+        }
+        file.write(row.data(), row.size());
+    }
+}
 }  // namespace Utils
 }  // namespace vge
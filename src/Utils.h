@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -7,6 +9,31 @@ namespace vge {
 namespace Utils {
 std::vector<char> readFile(const std::string& filepath);
 
+// Read-only view of a whole file mapped into memory. The data is page aligned and stays valid for the
+// lifetime of the object.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filepath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline const void* getData() const { return _data; }
+    inline size_t getSize() const { return _size; }
+
+private:
+    const void* _data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    void* _fileHandle = nullptr;
+    void* _mappingHandle = nullptr;
+#endif
+};
+
+// Writes tightly packed RGBA8 pixels as a binary PPM, dropping the alpha channel
+void writeImagePPM(const std::string& filepath, const void* rgbaPixels, uint32_t width, uint32_t height);
+
 template <typename T, typename... Rest>
 void hashCombine(std::size_t& seed, const T& v, const Rest&... rest) {
     seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace vge {
+
+// Vertex format used for a member type. Float vectors map to 32-bit floats; the small integer vectors
+// are meant for quantized attributes and are read as normalized values (e.g. u8vec4 colors, i16vec4
+// normals).
+template <typename T>
+struct VertexFormat;
+
+template <VkFormat Format>
+struct FormatConstant {
+    static constexpr VkFormat value = Format;
+};
+
+template <> struct VertexFormat<float> : FormatConstant<VK_FORMAT_R32_SFLOAT> {};
+template <> struct VertexFormat<glm::vec2> : FormatConstant<VK_FORMAT_R32G32_SFLOAT> {};
+template <> struct VertexFormat<glm::vec3> : FormatConstant<VK_FORMAT_R32G32B32_SFLOAT> {};
+template <> struct VertexFormat<glm::vec4> : FormatConstant<VK_FORMAT_R32G32B32A32_SFLOAT> {};
+template <> struct VertexFormat<uint32_t> : FormatConstant<VK_FORMAT_R32_UINT> {};
+template <> struct VertexFormat<glm::uvec4> : FormatConstant<VK_FORMAT_R32G32B32A32_UINT> {};
+template <> struct VertexFormat<glm::u8vec4> : FormatConstant<VK_FORMAT_R8G8B8A8_UNORM> {};
+template <> struct VertexFormat<glm::i8vec4> : FormatConstant<VK_FORMAT_R8G8B8A8_SNORM> {};
+template <> struct VertexFormat<glm::u16vec2> : FormatConstant<VK_FORMAT_R16G16_UNORM> {};
+template <> struct VertexFormat<glm::i16vec2> : FormatConstant<VK_FORMAT_R16G16_SNORM> {};
+template <> struct VertexFormat<glm::u16vec4> : FormatConstant<VK_FORMAT_R16G16B16A16_UNORM> {};
+template <> struct VertexFormat<glm::i16vec4> : FormatConstant<VK_FORMAT_R16G16B16A16_SNORM> {};
+
+// A member of a vertex struct, its type carried along so the layout size is known at compile time
+template <typename MemberType>
+struct VertexAttribute {
+    uint32_t offset;
+};
+
+// Describes the per-vertex buffer at binding 0 and the attributes read from it
+template <typename VertexType, size_t AttributeCount>
+struct VertexLayout {
+    std::array<VkVertexInputAttributeDescription, AttributeCount> attributes;
+
+    constexpr VkVertexInputBindingDescription binding() const {
+        return {0, static_cast<uint32_t>(sizeof(VertexType)), VK_VERTEX_INPUT_RATE_VERTEX};
+    }
+};
+
+template <typename MemberType, typename Attributes>
+constexpr void appendVertexAttribute(Attributes& attributes,
+                                     uint32_t& location,
+                                     VertexAttribute<MemberType> attribute) {
+    attributes[location] = {location, 0, VertexFormat<MemberType>::value, attribute.offset};
+    location++;
+}
+
+// Attribute locations follow declaration order starting at 0
+template <typename VertexType, typename... MemberTypes>
+constexpr auto makeVertexLayout(VertexAttribute<MemberTypes>... attributes) {
+    VertexLayout<VertexType, sizeof...(MemberTypes)> layout{};
+
+    uint32_t location = 0;
+    (appendVertexAttribute(layout.attributes, location, attributes), ...);
+    return layout;
+}
+
+// Component type and count a vertex format delivers to the shader, for validation against reflection
+struct VertexFormatInfo {
+    enum class ComponentType { Unknown, Float, SInt, UInt };
+
+    ComponentType componentType;
+    uint32_t componentCount;
+};
+
+constexpr VertexFormatInfo getVertexFormatInfo(VkFormat format) {
+    using Type = VertexFormatInfo::ComponentType;
+    switch (format) {
+        case VK_FORMAT_R32_SFLOAT: return {Type::Float, 1};
+        case VK_FORMAT_R32G32_SFLOAT: return {Type::Float, 2};
+        case VK_FORMAT_R32G32B32_SFLOAT: return {Type::Float, 3};
+        case VK_FORMAT_R32G32B32A32_SFLOAT: return {Type::Float, 4};
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SNORM:
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SNORM: return {Type::Float, 4};
+        case VK_FORMAT_R16G16_UNORM:
+        case VK_FORMAT_R16G16_SNORM: return {Type::Float, 2};
+        case VK_FORMAT_R32_UINT: return {Type::UInt, 1};
+        case VK_FORMAT_R32G32B32A32_UINT: return {Type::UInt, 4};
+        case VK_FORMAT_R32_SINT: return {Type::SInt, 1};
+        case VK_FORMAT_R32G32B32A32_SINT: return {Type::SInt, 4};
+        default: return {Type::Unknown, 0};
+    }
+}
+
+}  // namespace vge
+
+// Attribute for makeVertexLayout, format deduced from the member's type
+#define VGE_VERTEX_ATTRIBUTE(VertexType, member) \
+    ::vge::VertexAttribute<decltype(VertexType::member)>{static_cast<uint32_t>(offsetof(VertexType, member))}
@@ -8,6 +8,7 @@ Window::Window(int width, int height, std::string name)
     : _width{width}
     , _height{height}
     , _isFramebufferResized{false}
+    , _isRefreshRequested{false}
     , _name{name} {
     initWindow();
 }
@@ -25,6 +26,8 @@ void Window::initWindow() {
     _window = glfwCreateWindow(_width, _height, _name.c_str(), nullptr, nullptr);
     glfwSetWindowUserPointer(_window, this);
     glfwSetFramebufferSizeCallback(_window, framebufferResizeCallback);
+    glfwSetWindowRefreshCallback(_window, windowRefreshCallback);
+    glfwSetKeyCallback(_window, keyCallback);
 }
 
 void Window::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface) {
@@ -40,4 +43,18 @@ void Window::framebufferResizeCallback(GLFWwindow *_window, int _width, int _hei
     window->_height = _height;
 }
 
+void Window::windowRefreshCallback(GLFWwindow *_window) {
+    auto window = reinterpret_cast<Window*>(glfwGetWindowUserPointer(_window));
+    window->_isRefreshRequested = true;
+}
+
+void Window::keyCallback(GLFWwindow *_window, int key, int scancode, int action, int mods) {
+    if (key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT) {
+        return;
+    }
+
+    auto window = reinterpret_cast<Window*>(glfwGetWindowUserPointer(_window));
+    window->_inputState.pressedKeys.set(key, action == GLFW_PRESS);
+}
+
 }  // namespace vge
@@ -3,9 +3,17 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <bitset>
 #include <string>
 namespace vge {
 
+// Keyboard state captured on the main thread, safe to hand to other threads
+struct InputState {
+    std::bitset<GLFW_KEY_LAST + 1> pressedKeys;
+
+    inline bool isPressed(int key) const { return key >= 0 && key <= GLFW_KEY_LAST && pressedKeys.test(key); }
+};
+
 class Window {
 public:
     Window(int width, int height, std::string name);
@@ -17,22 +25,31 @@ public:
     inline bool shouldClose() const { return glfwWindowShouldClose(_window); }
     inline VkExtent2D getExtent() const { return {static_cast<uint32_t>(_width), static_cast<uint32_t>(_height)}; }
     inline bool wasResized() const { return _isFramebufferResized; }
+    inline bool wasRefreshRequested() const { return _isRefreshRequested; }
     inline GLFWwindow *getGLFWWindow() const { return _window; }
+    inline const InputState &getInputState() const { return _inputState; }
 
+    // The framebuffer resize shows up once events are next processed
+    inline void setSize(int width, int height) { glfwSetWindowSize(_window, width, height); }
     inline void resetWindowResizedFlag() { _isFramebufferResized = false; }
+    inline void resetRefreshRequestedFlag() { _isRefreshRequested = false; }
 
     void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface);
 
 private:
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+    static void windowRefreshCallback(GLFWwindow* window);
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
     void initWindow();
 
 private:
     int _width;
     int _height;
     bool _isFramebufferResized;
+    bool _isRefreshRequested;
 
     std::string _name;
     GLFWwindow* _window;
+    InputState _inputState;
 };
 }  // namespace vge
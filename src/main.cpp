@@ -1,12 +1,162 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <filesystem>
 #include <iostream>
+#include <random>
+#include <string>
+#include <vector>
 
 #include "Application.h"
+#include "FrustumCuller.h"
+#include "GameObject.h"
+#include "ShaderBlobStore.h"
 
-int main() {
-    vge::Application app;
+#include <glm/gtc/constants.hpp>
+
+// Packs every compiled shader next to the archive path into the archive loaded at startup
+static int packShaders() {
+    auto shaderDirectory = std::filesystem::path(vge::ShaderBlobStore::ARCHIVE_PATH).parent_path();
+
+    std::vector<std::string> filepaths;
+    for (const auto& entry : std::filesystem::directory_iterator(shaderDirectory)) {
+        if (entry.path().extension() == ".spv") {
+            filepaths.push_back(entry.path().string());
+        }
+    }
+
+    vge::ShaderBlobStore::writeArchive(vge::ShaderBlobStore::ARCHIVE_PATH, filepaths);
+    return 0;
+}
+
+// Times CPU frustum culling of randomly placed unit cubes around the camera, no GPU involved
+static int benchmarkCulling() {
+    constexpr int ITERATIONS = 20;
+    using Milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>;
+
+    vge::Camera camera{};
+    camera.setPerspectiveProjection(glm::radians(50.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    camera.setViewYXZ({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f});
+    const auto planes = camera.getFrustumPlanes();
+    const vge::Model::BoundingBox box{glm::vec3{-0.5f}, glm::vec3{0.5f}};
+
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> position{-100.0f, 100.0f};
+    std::uniform_real_distribution<float> rotation{0.0f, glm::two_pi<float>()};
+    std::uniform_real_distribution<float> scale{0.5f, 2.0f};
+
+    std::cout << "Frustum culling, " << vge::FrustumCuller::simdPath() << " path, average of " << ITERATIONS
+              << " runs\n";
+
+    for (size_t count : {10'000u, 100'000u, 1'000'000u}) {
+        std::vector<glm::mat4> modelMatrices(count);
+        for (auto& modelMatrix : modelMatrices) {
+            vge::TransformComponent transform{};
+            transform.translation = {position(random), position(random), position(random)};
+            transform.rotation = {rotation(random), rotation(random), rotation(random)};
+            transform.scale = glm::vec3{scale(random)};
+            modelMatrix = transform.mat4();
+        }
+
+        vge::FrustumCuller culler;
+        std::vector<uint8_t> visibility;
+        size_t visibleCount = 0;
+        float gatherTime = 0.0f;
+        float cullTime = 0.0f;
+
+        for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            culler.clear();
+            culler.reserve(count);
+            for (const auto& modelMatrix : modelMatrices) {
+                culler.add(box, modelMatrix);
+            }
+            auto gathered = std::chrono::high_resolution_clock::now();
+            visibleCount = culler.cull(planes, visibility);
+            auto culled = std::chrono::high_resolution_clock::now();
+
+            gatherTime += Milliseconds(gathered - start).count();
+            cullTime += Milliseconds(culled - gathered).count();
+        }
+
+        gatherTime /= ITERATIONS;
+        cullTime /= ITERATIONS;
+        std::cout << count << " objects: bounds " << gatherTime << "ms, cull " << cullTime << "ms ("
+                  << cullTime * 1e6f / count << "ns per object), " << visibleCount << " visible\n";
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && std::strcmp(argv[1], "--pack-shaders") == 0) {
+        try {
+            return packShaders();
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (argc == 2 && std::strcmp(argv[1], "--bench-culling") == 0) {
+        return benchmarkCulling();
+    }
+
+    auto config = vge::Application::defaultConfig();
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            config.headless = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            config.frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            config.capturePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--idle-skipping") == 0) {
+            config.idleSkipping = true;
+        } else if (std::strcmp(argv[i], "--static-lights") == 0) {
+            config.animateLights = false;
+        } else if (std::strcmp(argv[i], "--serial") == 0) {
+            config.pipelined = false;
+        } else if (std::strcmp(argv[i], "--no-specular") == 0) {
+            config.shading.specular = false;
+        } else if (std::strcmp(argv[i], "--ambient-only") == 0) {
+            config.shading.ambientOnly = true;
+        } else if (std::strcmp(argv[i], "--depth-prepass") == 0) {
+            config.shading.depthPrePass = true;
+        } else if (std::strcmp(argv[i], "--deferred") == 0) {
+            config.shading.deferred = true;
+        } else if (std::strcmp(argv[i], "--hot-reload") == 0) {
+            config.hotReload = true;
+        } else if (std::strcmp(argv[i], "--gpu-driven") == 0) {
+            config.gpuDriven = true;
+        } else if (std::strcmp(argv[i], "--gpu-culling") == 0) {
+            config.gpuDriven = true;
+            config.culling = vge::RenderSystem::CullingMode::Gpu;
+        } else if (std::strcmp(argv[i], "--occlusion-culling") == 0) {
+            config.gpuDriven = true;
+            config.culling = vge::RenderSystem::CullingMode::Occlusion;
+        } else if (std::strcmp(argv[i], "--software-occlusion") == 0) {
+            config.culling = vge::RenderSystem::CullingMode::Software;
+        } else if (std::strcmp(argv[i], "--no-culling") == 0) {
+            config.culling = vge::RenderSystem::CullingMode::None;
+        } else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+            config.extraLights = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--resize-test") == 0 && i + 1 < argc) {
+            config.resizeTestCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::cout << "Usage: " << argv[0]
+                      << " [--headless] [--frames N] [--capture image.ppm] [--idle-skipping] [--static-lights]"
+                      << " [--serial] [--no-specular] [--ambient-only] [--depth-prepass] [--deferred]"
+                      << " [--hot-reload] [--gpu-driven] [--gpu-culling] [--occlusion-culling] [--no-culling]"
+                      << " [--software-occlusion] [--lights N] [--resize-test N]\n"
+                      << "       " << argv[0] << " --pack-shaders\n"
+                      << "       " << argv[0] << " --bench-culling\n";
+            return EXIT_FAILURE;
+        }
+    }
 
     try {
+        vge::Application app{config};
         app.run();
     } catch (const std::exception& e) {
         std::cout << "Error: " << e.what() << '\n';
@@ -14,4 +164,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,241 @@
+#include "CullingSystem.h"
+
+#include "SwapChain.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace vge {
+
+struct CullPushConstants {
+    glm::vec4 frustumPlanes[6];
+    uint32_t objectCount;
+};
+
+// No room left for the frustum planes next to the matrix, occlusion_cull.comp derives them
+struct OcclusionCullPushConstants {
+    glm::mat4 projectionView;
+    glm::uvec2 pyramidSize;
+    uint32_t pyramidLevelCount;
+    uint32_t objectCount;
+    uint32_t phase;
+    uint32_t lateDrawOffset;
+};
+
+// Must match occlusion_cull.comp
+enum OcclusionCullPhase : uint32_t {
+    OCCLUSION_CULL_PHASE_EARLY = 0,
+    OCCLUSION_CULL_PHASE_LATE = 1,
+};
+
+// Layout of the stats buffer, must match the shaders
+struct CullStats {
+    uint32_t visibleCount;
+    uint32_t occludedCount;
+};
+
+CullingSystem::CullingSystem(Device& device, PipelineRegistry& pipelineRegistry, bool occlusionCulling)
+    : _device{device}
+    , _descriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+    , _statsBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT)
+    , _submittedCounts(SwapChain::MAX_FRAMES_IN_FLIGHT, 0)
+    , _pushConstantSize{static_cast<uint32_t>(occlusionCulling ? sizeof(OcclusionCullPushConstants)
+                                                               : sizeof(CullPushConstants))} {
+    DescriptorSetLayout::Builder layoutBuilder{_device};
+    layoutBuilder.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    DescriptorPool::Builder poolBuilder{_device};
+    poolBuilder.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+    // Visibility and the depth pyramid
+    if (occlusionCulling) {
+        layoutBuilder.addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+        poolBuilder.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+        _depthPyramidSystem = std::make_unique<DepthPyramidSystem>(_device, pipelineRegistry);
+        _visibilityBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    } else {
+        poolBuilder.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * SwapChain::MAX_FRAMES_IN_FLIGHT);
+    }
+    _setLayout = layoutBuilder.build(pipelineRegistry.getLayoutCache());
+    _pool = poolBuilder.build();
+
+    for (auto& statsBuffer : _statsBuffers) {
+        statsBuffer = std::make_unique<Buffer>(_device,
+                                               sizeof(CullStats),
+                                               1,
+                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        statsBuffer->map();
+    }
+
+    createPipelineLayout();
+    createPipeline(pipelineRegistry);
+}
+
+CullingSystem::~CullingSystem() { vkDestroyPipelineLayout(_device.getVkDevice(), _pipelineLayout, nullptr); }
+
+void CullingSystem::createPipelineLayout() {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = _pushConstantSize;
+
+    VkDescriptorSetLayout setLayout = _setLayout->getDescriptorSetLayout();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(_device.getVkDevice(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+}
+
+void CullingSystem::createPipeline(PipelineRegistry& pipelineRegistry) {
+    auto shaderModule = pipelineRegistry.getShaderModule(
+        hasOcclusionCulling() ? "../shaders/occlusion_cull.comp.spv" : "../shaders/cull.comp.spv");
+    _pipeline = std::make_unique<ComputePipeline>(_device, shaderModule, _pipelineLayout, _pushConstantSize);
+}
+
+void CullingSystem::setBuffers(int frameIndex, Buffer& cullObjects, Buffer& objects, Buffer& drawCommands) {
+    std::array<VkDescriptorBufferInfo, 5> bufferInfos{cullObjects.descriptorInfo(),
+                                                      objects.descriptorInfo(),
+                                                      drawCommands.descriptorInfo(),
+                                                      _statsBuffers[frameIndex]->descriptorInfo()};
+    uint32_t bufferCount = 4;
+
+    // Indexed by object ID, which stays below the number of cull objects. Starting out with nothing visible
+    // sends every object through the second phase once.
+    if (hasOcclusionCulling()) {
+        auto& visibilityBuffer = _visibilityBuffers[frameIndex];
+        visibilityBuffer = std::make_unique<Buffer>(_device,
+                                                    sizeof(uint32_t),
+                                                    cullObjects.getInstanceCount(),
+                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        visibilityBuffer->map();
+        std::memset(visibilityBuffer->getMappedMemory(), 0, visibilityBuffer->getBufferSize());
+        bufferInfos[bufferCount++] = visibilityBuffer->descriptorInfo();
+    }
+
+    DescriptorWriter writer{*_setLayout, *_pool};
+    for (uint32_t binding = 0; binding < bufferCount; binding++) {
+        writer.writeBuffer(binding, &bufferInfos[binding]);
+    }
+
+    if (_descriptorSets[frameIndex] == VK_NULL_HANDLE) {
+        writer.build(_descriptorSets[frameIndex]);
+    } else {
+        writer.overwrite(_descriptorSets[frameIndex]);
+    }
+}
+
+void CullingSystem::cull(CommandRecorder& recorder,
+                         int frameIndex,
+                         const Camera& camera,
+                         uint32_t objectCount,
+                         VkExtent2D depthExtent) {
+    // The fence of this frame slot was waited on, so the counters hold the result of its previous use
+    auto stats = static_cast<CullStats*>(_statsBuffers[frameIndex]->getMappedMemory());
+    if (_submittedCounts[frameIndex] > 0) {
+        _stats.visibleCount = stats->visibleCount;
+        _stats.culledCount = _submittedCounts[frameIndex] - stats->visibleCount;
+        _stats.occludedCount = stats->occludedCount;
+    }
+    *stats = {};
+    _submittedCounts[frameIndex] = objectCount;
+
+    // Has to happen before the set is bound below, it can't be updated while the command buffer uses it
+    if (hasOcclusionCulling() && _depthPyramidSystem->resize(frameIndex, depthExtent)) {
+        auto pyramidInfo = _depthPyramidSystem->descriptorInfo(frameIndex);
+        DescriptorWriter(*_setLayout, *_pool)
+            .writeImage(5, &pyramidInfo)
+            .overwrite(_descriptorSets[frameIndex]);
+    }
+
+    if (objectCount == 0) {
+        return;
+    }
+
+    if (hasOcclusionCulling()) {
+        OcclusionCullPushConstants push{};
+        push.projectionView = camera.getProjectionViewMatrix();
+        push.objectCount = objectCount;
+        push.phase = OCCLUSION_CULL_PHASE_EARLY;
+        dispatch(recorder, frameIndex, &push, objectCount);
+        return;
+    }
+
+    CullPushConstants push{};
+    auto planes = camera.getFrustumPlanes();
+    std::copy(planes.begin(), planes.end(), push.frustumPlanes);
+    push.objectCount = objectCount;
+    dispatch(recorder, frameIndex, &push, objectCount);
+}
+
+void CullingSystem::cullOccluded(CommandRecorder& recorder,
+                                 int frameIndex,
+                                 const Camera& camera,
+                                 uint32_t objectCount,
+                                 uint32_t lateDrawOffset,
+                                 const DepthAttachment& depth) {
+    assert(hasOcclusionCulling() && "Occlusion culling was not enabled");
+    if (objectCount == 0) {
+        return;
+    }
+
+    _depthPyramidSystem->build(recorder, frameIndex, depth);
+
+    const VkExtent2D pyramidExtent = _depthPyramidSystem->getExtent(frameIndex);
+    OcclusionCullPushConstants push{};
+    push.projectionView = camera.getProjectionViewMatrix();
+    push.pyramidSize = {pyramidExtent.width, pyramidExtent.height};
+    push.pyramidLevelCount = _depthPyramidSystem->getLevelCount(frameIndex);
+    push.objectCount = objectCount;
+    push.phase = OCCLUSION_CULL_PHASE_LATE;
+    push.lateDrawOffset = lateDrawOffset;
+    dispatch(recorder, frameIndex, &push, objectCount);
+}
+
+void CullingSystem::dispatch(CommandRecorder& recorder,
+                             int frameIndex,
+                             const void* push,
+                             uint32_t objectCount) {
+    _pipeline->bind(recorder);
+    recorder.bindDescriptorSets(
+        VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &_descriptorSets[frameIndex]);
+    recorder.pushConstants(_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, _pushConstantSize, push);
+    recorder.dispatch(ComputePipeline::groupCount(objectCount, GROUP_SIZE), 1, 1);
+
+    // Draw commands feed the indirect draws, compacted objects the vertex shaders, the counter the host
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(recorder.getCommandBuffer(),
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                             VK_PIPELINE_STAGE_HOST_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+}
+}  // namespace vge
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Buffer.h"
+#include "Camera.h"
+#include "ComputePipeline.h"
+#include "Descriptor.h"
+#include "Device.h"
+#include "PipelineRegistry.h"
+#include "RenderTarget.h"
+#include "DepthPyramidSystem.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace vge {
+
+// Frustum culls objects on the GPU. Every visible object is appended to its model's indirect draw command,
+// whose instanceCount serves as an atomic counter, and its transforms are compacted into the object buffer
+// the vertex shaders read. Needs nothing beyond Vulkan 1.0.
+//
+// With occlusion culling the objects are also tested against a depth pyramid, in two phases. The first draws
+// the objects that were visible when the frame slot was last used. The pyramid is then built from the depth
+// they left, and the second phase tests every object against it, drawing those the first phase missed.
+class CullingSystem {
+public:
+    // Must match cull.comp
+    static constexpr uint32_t GROUP_SIZE = 64;
+
+    // Input entry of cull.comp, std430
+    struct CullObject {
+        glm::mat4 modelMatrix{1.0f};
+        glm::mat4 normalMatrix{1.0f};
+        // Model-space center in xyz, radius in w
+        glm::vec4 boundingSphere{};
+        // Indirect draw command, i.e. model, the object belongs to
+        uint32_t drawIndex;
+        // Stable across frames while the scene doesn't change, indexes the occlusion visibility
+        uint32_t objectId;
+        uint32_t padding[2];
+    };
+
+    // Counts of the most recent frame whose results arrived. They lag MAX_FRAMES_IN_FLIGHT frames behind
+    // since they are only read once the frame's fence was waited on anyway.
+    struct Stats {
+        uint32_t visibleCount;
+        uint32_t culledCount;
+        // Part of culledCount: inside the frustum, but hidden behind the depth pyramid
+        uint32_t occludedCount;
+    };
+
+    CullingSystem(Device &device, PipelineRegistry &pipelineRegistry, bool occlusionCulling = false);
+    ~CullingSystem();
+
+    CullingSystem(const CullingSystem &) = delete;
+    CullingSystem &operator=(const CullingSystem &) = delete;
+
+    // Points the frame's descriptor set at its buffers. Called again whenever one of them is reallocated.
+    // With occlusion culling, objects and drawCommands hold room for both phases.
+    void setBuffers(int frameIndex, Buffer &cullObjects, Buffer &objects, Buffer &drawCommands);
+
+    // Records the cull dispatch and the barrier that hands its output to the indirect draws and vertex
+    // shaders. Must be recorded outside a render pass, after the frame's fence was waited on. With occlusion
+    // culling this is the first phase, and depthExtent the size of the depth buffer the pyramid is built
+    // from.
+    void cull(CommandRecorder &recorder,
+              int frameIndex,
+              const Camera &camera,
+              uint32_t objectCount,
+              VkExtent2D depthExtent = {});
+
+    // Occlusion culling only: builds the pyramid from the depth the first phase's draws left and records the
+    // second phase, which fills the draw commands from lateDrawOffset on. Must be recorded outside a render
+    // pass.
+    void cullOccluded(CommandRecorder &recorder,
+                      int frameIndex,
+                      const Camera &camera,
+                      uint32_t objectCount,
+                      uint32_t lateDrawOffset,
+                      const DepthAttachment &depth);
+
+    inline bool hasOcclusionCulling() const { return _depthPyramidSystem != nullptr; }
+    inline const Stats &getStats() const { return _stats; }
+
+private:
+    void createPipelineLayout();
+    void createPipeline(PipelineRegistry &pipelineRegistry);
+    void dispatch(CommandRecorder &recorder, int frameIndex, const void *push, uint32_t objectCount);
+
+private:
+    Device &_device;
+
+    std::shared_ptr<DescriptorSetLayout> _setLayout;
+    std::unique_ptr<DescriptorPool> _pool;
+    std::vector<VkDescriptorSet> _descriptorSets;
+    // One host-visible visible-object counter per frame in flight
+    std::vector<std::unique_ptr<Buffer>> _statsBuffers;
+    // Objects submitted for culling in the frame that last used each stats buffer
+    std::vector<uint32_t> _submittedCounts;
+    Stats _stats{};
+
+    // Occlusion culling only. Whether each object was visible, per frame in flight, so the first phase works
+    // from visibility MAX_FRAMES_IN_FLIGHT frames old.
+    std::unique_ptr<DepthPyramidSystem> _depthPyramidSystem;
+    std::vector<std::unique_ptr<Buffer>> _visibilityBuffers;
+
+    uint32_t _pushConstantSize;
+    VkPipelineLayout _pipelineLayout;
+    std::unique_ptr<ComputePipeline> _pipeline;
+};
+}  // namespace vge
@@ -0,0 +1,117 @@
+#include "DeferredLightingSystem.h"
+
+#include "SwapChain.h"
+
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace vge {
+
+DeferredLightingSystem::DeferredLightingSystem(Device& device,
+                                               PipelineRegistry& pipelineRegistry,
+                                               VkRenderPass renderPass,
+                                               const RenderPassSignature& renderPassSignature,
+                                               VkDescriptorSetLayout globalSetLayout,
+                                               const RenderSystem::ShadingOptions& shadingOptions)
+    : _device{device}
+    , _ambientOnly{shadingOptions.ambientOnly}
+    , _inputDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT) {
+    _inputSetLayout = DescriptorSetLayout::Builder(_device)
+                          .addBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                          .addBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                          .addBinding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                          .build(pipelineRegistry.getLayoutCache());
+    _inputPool = DescriptorPool::Builder(_device)
+                     .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+                     .addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 3 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+                     .build();
+
+    for (auto& descriptorSet : _inputDescriptorSets) {
+        if (!_inputPool->allocateDescriptor(_inputSetLayout->getDescriptorSetLayout(), descriptorSet)) {
+            throw std::runtime_error("failed to allocate G-buffer descriptor set!");
+        }
+    }
+
+    createPipelineLayout(pipelineRegistry, globalSetLayout);
+    createPipelines(pipelineRegistry, renderPass, renderPassSignature, shadingOptions);
+}
+
+DeferredLightingSystem::~DeferredLightingSystem() {
+    // The compile jobs may still be using the layout
+    _ambientPipeline.wait();
+    _lightPipeline.wait();
+}
+
+void DeferredLightingSystem::createPipelineLayout(PipelineRegistry& pipelineRegistry,
+                                                  VkDescriptorSetLayout globalSetLayout) {
+    _pipelineLayout = pipelineRegistry.getPipelineLayoutCache().getLayout(
+        {globalSetLayout, _inputSetLayout->getDescriptorSetLayout()});
+}
+
+void DeferredLightingSystem::createPipelines(PipelineRegistry& pipelineRegistry,
+                                             VkRenderPass renderPass,
+                                             const RenderPassSignature& renderPassSignature,
+                                             const RenderSystem::ShadingOptions& shadingOptions) {
+    assert(_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+    PipelineConfigInfo configInfo{};
+    Pipeline::defaultPipelineConfigInfo(configInfo);
+    configInfo.attributeDescriptions.clear();
+    configInfo.bindingDescriptions.clear();
+    configInfo.renderPass = renderPass;
+    configInfo.renderPassSignature = renderPassSignature;
+    configInfo.subpass = GBuffer::LIGHTING_SUBPASS;
+    configInfo.pipelineLayout = _pipelineLayout;
+    // Depth is read-only in the lighting subpass
+    configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+    PipelineDesc ambientDesc{
+        "../shaders/deferred_ambient.vert.spv", "../shaders/deferred_ambient.frag.spv", configInfo};
+    ambientDesc.configInfo.depthStencilInfo.depthTestEnable = VK_FALSE;
+    ambientDesc.configInfo.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+    _ambientPipeline = pipelineRegistry.getPipeline(ambientDesc);
+
+    // Back faces of the volume, so the light still applies with the camera inside it. They pass where the
+    // stored surface lies in front of them, i.e. possibly within the light's range.
+    PipelineDesc lightDesc{
+        "../shaders/deferred_light.vert.spv", "../shaders/deferred_light.frag.spv", configInfo};
+    Pipeline::enableAdditiveBlending(lightDesc.configInfo);
+    lightDesc.configInfo.rasterizationInfo.cullMode = VK_CULL_MODE_FRONT_BIT;
+    lightDesc.configInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+    Pipeline::setSpecializationConstant(
+        lightDesc.configInfo, SHADER_CONSTANT_SPECULAR_ENABLED, shadingOptions.specular ? VK_TRUE : VK_FALSE);
+    _lightPipeline = pipelineRegistry.getPipeline(lightDesc);
+}
+
+void DeferredLightingSystem::render(FrameInfo& frameInfo,
+                                    const GBuffer::Attachments& gBuffer,
+                                    uint32_t lightCount) {
+    // The set was last used MAX_FRAMES_IN_FLIGHT frames ago, whose fence has been waited on
+    std::array<VkDescriptorImageInfo, 3> imageInfos{{
+        {VK_NULL_HANDLE, gBuffer.albedo, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {VK_NULL_HANDLE, gBuffer.normal, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {VK_NULL_HANDLE, gBuffer.depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+    }};
+    DescriptorWriter writer{*_inputSetLayout, *_inputPool};
+    for (uint32_t binding = 0; binding < imageInfos.size(); binding++) {
+        writer.writeImage(binding, &imageInfos[binding]);
+    }
+    writer.overwrite(_inputDescriptorSets[frameInfo.frameIndex]);
+
+    auto& recorder = frameInfo.recorder;
+    VkDescriptorSet descriptorSets[] = {frameInfo.globalDescriptorSet,
+                                        _inputDescriptorSets[frameInfo.frameIndex]};
+    recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 2, descriptorSets);
+
+    _ambientPipeline.get()->bind(recorder);
+    recorder.draw(3, 1, 0, 0);
+
+    if (_ambientOnly || lightCount == 0) {
+        return;
+    }
+
+    _lightPipeline.get()->bind(recorder);
+    recorder.draw(36, lightCount, 0, 0);
+}
+}  // namespace vge
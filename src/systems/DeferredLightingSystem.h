@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Descriptor.h"
+#include "Device.h"
+#include "FrameInfo.h"
+#include "GBuffer.h"
+#include "Pipeline.h"
+#include "PipelineRegistry.h"
+#include "RenderSystem.h"
+
+namespace vge {
+
+// Lighting subpass of the deferred path. Ambient light is applied with one fullscreen triangle, then every
+// point light is drawn as an instanced cube around its range and added on top. Only the pixels inside a
+// light's volume read the G-buffer for it, so the cost follows the lights' screen coverage rather than the
+// scene's overdraw.
+class DeferredLightingSystem {
+public:
+    DeferredLightingSystem(Device &device,
+                           PipelineRegistry &pipelineRegistry,
+                           VkRenderPass renderPass,
+                           const RenderPassSignature &renderPassSignature,
+                           VkDescriptorSetLayout globalSetLayout,
+                           const RenderSystem::ShadingOptions &shadingOptions);
+    ~DeferredLightingSystem();
+
+    DeferredLightingSystem(const DeferredLightingSystem &) = delete;
+    DeferredLightingSystem &operator=(const DeferredLightingSystem &) = delete;
+
+    // Must be recorded in the lighting subpass. gBuffer holds the attachments of the framebuffer being
+    // rendered, they change with the swap chain image.
+    void render(FrameInfo &frameInfo, const GBuffer::Attachments &gBuffer, uint32_t lightCount);
+
+private:
+    void createPipelineLayout(PipelineRegistry &pipelineRegistry, VkDescriptorSetLayout globalSetLayout);
+    void createPipelines(PipelineRegistry &pipelineRegistry,
+                         VkRenderPass renderPass,
+                         const RenderPassSignature &renderPassSignature,
+                         const RenderSystem::ShadingOptions &shadingOptions);
+
+private:
+    Device &_device;
+    bool _ambientOnly;
+
+    // Set 1: the G-buffer input attachments. One set per frame in flight, rewritten every frame.
+    std::shared_ptr<DescriptorSetLayout> _inputSetLayout;
+    std::unique_ptr<DescriptorPool> _inputPool;
+    std::vector<VkDescriptorSet> _inputDescriptorSets;
+
+    // Compiled in the background, the first render call waits for them
+    PipelineCompiler::PipelineFuture _ambientPipeline;
+    PipelineCompiler::PipelineFuture _lightPipeline;
+    // Owned by the registry's pipeline layout cache
+    VkPipelineLayout _pipelineLayout;
+};
+}  // namespace vge
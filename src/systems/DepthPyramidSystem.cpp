@@ -0,0 +1,307 @@
+#include "DepthPyramidSystem.h"
+
+#include "SwapChain.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace vge {
+
+static constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+static constexpr VkPipelineStageFlags DEPTH_TEST_STAGES =
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+struct DepthPyramidPushConstants {
+    glm::uvec2 sourceSize;
+    glm::uvec2 levelSize;
+};
+
+DepthPyramidSystem::DepthPyramidSystem(Device& device, PipelineRegistry& pipelineRegistry)
+    : _device{device}
+    , _pyramids(SwapChain::MAX_FRAMES_IN_FLIGHT) {
+    _setLayout = DescriptorSetLayout::Builder(_device)
+                     .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                     .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                     .build(pipelineRegistry.getLayoutCache());
+
+    const uint32_t setCount = MAX_LEVEL_COUNT * SwapChain::MAX_FRAMES_IN_FLIGHT;
+    _pool = DescriptorPool::Builder(_device)
+                .setMaxSets(setCount)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount)
+                .build();
+
+    // Allocated up front for the deepest pyramid, resizing only rewrites them
+    for (auto& pyramid : _pyramids) {
+        pyramid.descriptorSets.resize(MAX_LEVEL_COUNT);
+        for (auto& descriptorSet : pyramid.descriptorSets) {
+            if (!_pool->allocateDescriptor(_setLayout->getDescriptorSetLayout(), descriptorSet)) {
+                throw std::runtime_error("failed to allocate depth pyramid descriptor set!");
+            }
+        }
+    }
+
+    createSampler();
+    createPipelineLayout();
+    createPipeline(pipelineRegistry);
+}
+
+DepthPyramidSystem::~DepthPyramidSystem() {
+    for (auto& pyramid : _pyramids) {
+        destroyPyramid(pyramid);
+    }
+    vkDestroySampler(_device.getVkDevice(), _sampler, nullptr);
+    vkDestroyPipelineLayout(_device.getVkDevice(), _pipelineLayout, nullptr);
+}
+
+void DepthPyramidSystem::createPipelineLayout() {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DepthPyramidPushConstants);
+
+    VkDescriptorSetLayout setLayout = _setLayout->getDescriptorSetLayout();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(_device.getVkDevice(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+}
+
+void DepthPyramidSystem::createPipeline(PipelineRegistry& pipelineRegistry) {
+    auto shaderModule = pipelineRegistry.getShaderModule("../shaders/depth_pyramid.comp.spv");
+    _pipeline = std::make_unique<ComputePipeline>(
+        _device, shaderModule, _pipelineLayout, static_cast<uint32_t>(sizeof(DepthPyramidPushConstants)));
+}
+
+void DepthPyramidSystem::createSampler() {
+    // Only ever read with texelFetch, which ignores filtering
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(MAX_LEVEL_COUNT);
+
+    if (vkCreateSampler(_device.getVkDevice(), &samplerInfo, nullptr, &_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pyramid sampler!");
+    }
+}
+
+bool DepthPyramidSystem::resize(int frameIndex, VkExtent2D depthExtent) {
+    Pyramid& pyramid = _pyramids[frameIndex];
+    if (pyramid.image != VK_NULL_HANDLE && pyramid.depthExtent.width == depthExtent.width &&
+        pyramid.depthExtent.height == depthExtent.height) {
+        return false;
+    }
+
+    destroyPyramid(pyramid);
+    createPyramid(pyramid, depthExtent);
+    return true;
+}
+
+void DepthPyramidSystem::createPyramid(Pyramid& pyramid, VkExtent2D depthExtent) {
+    auto floorPowerOfTwo = [](uint32_t value) {
+        uint32_t result = 1;
+        while (result * 2 <= value) {
+            result *= 2;
+        }
+        return result;
+    };
+
+    pyramid.depthExtent = depthExtent;
+    pyramid.extent = {floorPowerOfTwo(depthExtent.width), floorPowerOfTwo(depthExtent.height)};
+    pyramid.levelCount = 1;
+    while ((std::max(pyramid.extent.width, pyramid.extent.height) >> pyramid.levelCount) > 0 &&
+           pyramid.levelCount < MAX_LEVEL_COUNT) {
+        ++pyramid.levelCount;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = pyramid.extent.width;
+    imageInfo.extent.height = pyramid.extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = pyramid.levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = PYRAMID_FORMAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.flags = 0;
+
+    _device.createImageWithInfo(
+        imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pyramid.image, pyramid.memory);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pyramid.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = PYRAMID_FORMAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = pyramid.levelCount;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(_device.getVkDevice(), &viewInfo, nullptr, &pyramid.view) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pyramid image view!");
+    }
+
+    pyramid.levelViews.resize(pyramid.levelCount);
+    for (uint32_t level = 0; level < pyramid.levelCount; level++) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        if (vkCreateImageView(_device.getVkDevice(), &viewInfo, nullptr, &pyramid.levelViews[level]) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid image view!");
+        }
+    }
+
+    // Level 0 reads the depth buffer, which build points it at every frame
+    for (uint32_t level = 0; level < pyramid.levelCount; level++) {
+        VkDescriptorImageInfo levelInfo{VK_NULL_HANDLE, pyramid.levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+        DescriptorWriter writer{*_setLayout, *_pool};
+        writer.writeImage(1, &levelInfo);
+
+        VkDescriptorImageInfo sourceInfo{};
+        if (level > 0) {
+            sourceInfo = {_sampler, pyramid.levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL};
+            writer.writeImage(0, &sourceInfo);
+        }
+        writer.overwrite(pyramid.descriptorSets[level]);
+    }
+}
+
+void DepthPyramidSystem::destroyPyramid(Pyramid& pyramid) {
+    for (auto levelView : pyramid.levelViews) {
+        vkDestroyImageView(_device.getVkDevice(), levelView, nullptr);
+    }
+    pyramid.levelViews.clear();
+
+    vkDestroyImageView(_device.getVkDevice(), pyramid.view, nullptr);
+    vkDestroyImage(_device.getVkDevice(), pyramid.image, nullptr);
+    vkFreeMemory(_device.getVkDevice(), pyramid.memory, nullptr);
+    pyramid.view = VK_NULL_HANDLE;
+    pyramid.image = VK_NULL_HANDLE;
+    pyramid.memory = VK_NULL_HANDLE;
+}
+
+void DepthPyramidSystem::build(CommandRecorder& recorder, int frameIndex, const DepthAttachment& depth) {
+    Pyramid& pyramid = _pyramids[frameIndex];
+    VkCommandBuffer commandBuffer = recorder.getCommandBuffer();
+
+    // The swap chain cycles through its depth images, so the source changes from frame to frame
+    VkDescriptorImageInfo depthInfo{_sampler, depth.view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    DescriptorWriter(*_setLayout, *_pool).writeImage(0, &depthInfo).overwrite(pyramid.descriptorSets[0]);
+
+    // Layout transitions of a combined depth/stencil image have to include both aspects
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (depth.format == VK_FORMAT_D32_SFLOAT_S8_UINT || depth.format == VK_FORMAT_D24_UNORM_S8_UINT) {
+        depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    std::array<VkImageMemoryBarrier, 2> barriers{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = depth.image;
+    barriers[0].subresourceRange = {depthAspect, 0, 1, 0, 1};
+
+    // Every level is rewritten, so the previous contents can go
+    barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].image = pyramid.image;
+    barriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramid.levelCount, 0, 1};
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         DEPTH_TEST_STAGES,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr,
+                         static_cast<uint32_t>(barriers.size()),
+                         barriers.data());
+
+    _pipeline->bind(recorder);
+
+    DepthPyramidPushConstants push{};
+    push.sourceSize = {depth.extent.width, depth.extent.height};
+    for (uint32_t level = 0; level < pyramid.levelCount; level++) {
+        push.levelSize = {std::max(pyramid.extent.width >> level, 1u),
+                          std::max(pyramid.extent.height >> level, 1u)};
+
+        recorder.bindDescriptorSets(
+            VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &pyramid.descriptorSets[level]);
+        recorder.pushConstants(
+            _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramidPushConstants), &push);
+        recorder.dispatch(ComputePipeline::groupCount(push.levelSize.x, GROUP_SIZE),
+                          ComputePipeline::groupCount(push.levelSize.y, GROUP_SIZE),
+                          1);
+
+        // The next level reads this one, the cull pass reads the finished pyramid
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+        push.sourceSize = push.levelSize;
+    }
+
+    // Back to depth testing for the rest of the frame
+    VkImageMemoryBarrier depthBarrier = barriers[0];
+    depthBarrier.srcAccessMask = 0;
+    depthBarrier.dstAccessMask =
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         DEPTH_TEST_STAGES,
+                         0,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr,
+                         1,
+                         &depthBarrier);
+}
+}  // namespace vge
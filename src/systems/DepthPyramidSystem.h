@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "CommandRecorder.h"
+#include "ComputePipeline.h"
+#include "Descriptor.h"
+#include "Device.h"
+#include "PipelineRegistry.h"
+#include "RenderTarget.h"
+
+namespace vge {
+
+// Builds a hierarchical depth buffer (Hi-Z) for occlusion culling. Level 0 is the depth buffer reduced to the
+// power of two below its size, every further level halves the one before. A texel holds the farthest depth of
+// the area it covers, so whatever lies nearer than that anywhere within the area may be visible.
+class DepthPyramidSystem {
+public:
+    // Must match depth_pyramid.comp
+    static constexpr uint32_t GROUP_SIZE = 8;
+    // Enough for a 16384 pixel wide depth buffer
+    static constexpr uint32_t MAX_LEVEL_COUNT = 15;
+
+    DepthPyramidSystem(Device &device, PipelineRegistry &pipelineRegistry);
+    ~DepthPyramidSystem();
+
+    DepthPyramidSystem(const DepthPyramidSystem &) = delete;
+    DepthPyramidSystem &operator=(const DepthPyramidSystem &) = delete;
+
+    // Recreates the frame's pyramid if the depth buffer changed size, returning true if it did. Descriptors
+    // referring to the old one must then be rewritten. Only called for the frame being recorded, whose fence
+    // was waited on, so the old pyramid is idle.
+    bool resize(int frameIndex, VkExtent2D depthExtent);
+
+    // Records the reduction of a depth buffer a render pass just left in DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    // and hands it back in that layout. Must be recorded outside a render pass.
+    void build(CommandRecorder &recorder, int frameIndex, const DepthAttachment &depth);
+
+    // Every level, in GENERAL layout, for texelFetch
+    inline VkDescriptorImageInfo descriptorInfo(int frameIndex) const {
+        return {_sampler, _pyramids[frameIndex].view, VK_IMAGE_LAYOUT_GENERAL};
+    }
+    inline VkExtent2D getExtent(int frameIndex) const { return _pyramids[frameIndex].extent; }
+    inline uint32_t getLevelCount(int frameIndex) const { return _pyramids[frameIndex].levelCount; }
+
+private:
+    struct Pyramid {
+        VkExtent2D depthExtent{};
+        VkExtent2D extent{};
+        uint32_t levelCount = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        std::vector<VkImageView> levelViews;
+        // One per level: reads the level before it, or the depth buffer for level 0, and writes the level
+        std::vector<VkDescriptorSet> descriptorSets;
+    };
+
+    void createPipelineLayout();
+    void createPipeline(PipelineRegistry &pipelineRegistry);
+    void createSampler();
+    void createPyramid(Pyramid &pyramid, VkExtent2D depthExtent);
+    void destroyPyramid(Pyramid &pyramid);
+
+private:
+    Device &_device;
+
+    std::shared_ptr<DescriptorSetLayout> _setLayout;
+    std::unique_ptr<DescriptorPool> _pool;
+    VkSampler _sampler;
+    // One per frame in flight, so resizing never touches a pyramid the GPU may still be reading
+    std::vector<Pyramid> _pyramids;
+
+    VkPipelineLayout _pipelineLayout;
+    std::unique_ptr<ComputePipeline> _pipeline;
+};
+}  // namespace vge
@@ -0,0 +1,142 @@
+#include "LightClusterSystem.h"
+
+#include "SwapChain.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace vge {
+
+struct LightClusterPushConstants {
+    uint32_t lightCount;
+    uint32_t maxIndexCount;
+};
+
+// Layout of the cluster buffer header, must match the shaders
+struct ClusterHeader {
+    uint32_t indexCount;
+    uint32_t overflowCount;
+    uint32_t cappedCount;
+    uint32_t padding;
+};
+
+LightClusterSystem::LightClusterSystem(Device& device,
+                                       PipelineRegistry& pipelineRegistry,
+                                       VkDescriptorSetLayout globalSetLayout)
+    : _device{device}
+    , _clusterBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT)
+    , _headerBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT) {
+    static_assert(sizeof(ClusterHeader) == CLUSTER_HEADER_SIZE, "cluster header layout mismatch");
+
+    for (auto& clusterBuffer : _clusterBuffers) {
+        clusterBuffer = std::make_unique<Buffer>(_device,
+                                                 CLUSTER_BUFFER_SIZE,
+                                                 1,
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+    for (auto& headerBuffer : _headerBuffers) {
+        headerBuffer = std::make_unique<Buffer>(_device,
+                                                sizeof(ClusterHeader),
+                                                1,
+                                                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        headerBuffer->map();
+        std::memset(headerBuffer->getMappedMemory(), 0, sizeof(ClusterHeader));
+    }
+
+    createPipelineLayout(globalSetLayout);
+    createPipeline(pipelineRegistry);
+}
+
+LightClusterSystem::~LightClusterSystem() {
+    vkDestroyPipelineLayout(_device.getVkDevice(), _pipelineLayout, nullptr);
+}
+
+void LightClusterSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(LightClusterPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &globalSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(_device.getVkDevice(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+}
+
+void LightClusterSystem::createPipeline(PipelineRegistry& pipelineRegistry) {
+    auto shaderModule = pipelineRegistry.getShaderModule("../shaders/light_cluster.comp.spv");
+    _pipeline = std::make_unique<ComputePipeline>(
+        _device, shaderModule, _pipelineLayout, static_cast<uint32_t>(sizeof(LightClusterPushConstants)));
+}
+
+void LightClusterSystem::buildClusters(FrameInfo& frameInfo, uint32_t lightCount) {
+    auto& recorder = frameInfo.recorder;
+    VkCommandBuffer commandBuffer = recorder.getCommandBuffer();
+
+    // The fence of this frame slot was waited on, so the header copy holds the counters of its previous use
+    const auto* header =
+        static_cast<const ClusterHeader*>(_headerBuffers[frameInfo.frameIndex]->getMappedMemory());
+    _stats.overflowCount += header->overflowCount;
+    _stats.cappedCount += header->cappedCount;
+
+    // The index counter is the list allocator, every frame starts from an empty index space
+    VkBuffer clusterBuffer = _clusterBuffers[frameInfo.frameIndex]->getBuffer();
+    vkCmdFillBuffer(commandBuffer, clusterBuffer, 0, CLUSTER_HEADER_SIZE, 0);
+
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         1,
+                         &clearBarrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+
+    LightClusterPushConstants push{};
+    push.lightCount = lightCount;
+    push.maxIndexCount = MAX_LIGHT_INDICES;
+
+    _pipeline->bind(recorder);
+    recorder.bindDescriptorSets(
+        VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet);
+    recorder.pushConstants(
+        _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(LightClusterPushConstants), &push);
+    recorder.dispatch(ComputePipeline::groupCount(CLUSTER_COUNT, GROUP_SIZE), 1, 1);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+
+    VkBufferCopy headerCopy{};
+    headerCopy.size = sizeof(ClusterHeader);
+    vkCmdCopyBuffer(
+        commandBuffer, clusterBuffer, _headerBuffers[frameInfo.frameIndex]->getBuffer(), 1, &headerCopy);
+}
+}  // namespace vge
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Buffer.h"
+#include "ComputePipeline.h"
+#include "Device.h"
+#include "FrameInfo.h"
+#include "PipelineRegistry.h"
+
+namespace vge {
+
+// Bins the point lights into a grid of view-space froxels for clustered forward shading. Each frame a
+// compute pass intersects every cluster with every light's range and writes per-cluster light index lists,
+// so a fragment only iterates the lights that can reach it.
+class LightClusterSystem {
+public:
+    // Must match light_cluster.comp and shader.frag. Tiles in x and y, exponential depth slices in z.
+    static constexpr uint32_t GRID_X = 16;
+    static constexpr uint32_t GRID_Y = 9;
+    static constexpr uint32_t GRID_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    static constexpr uint32_t GROUP_SIZE = 64;
+    // Index space for all clusters together, sized for 32 lights per cluster on average
+    static constexpr uint32_t MAX_LIGHT_INDICES = CLUSTER_COUNT * 32;
+    // The index counter and the two drop counters, padded to the alignment of the cluster array
+    static constexpr VkDeviceSize CLUSTER_HEADER_SIZE = 4 * sizeof(uint32_t);
+    // The header followed by an (offset, count) pair per cluster and then the index lists, std430
+    static constexpr VkDeviceSize CLUSTER_BUFFER_SIZE =
+        CLUSTER_HEADER_SIZE + CLUSTER_COUNT * 2 * sizeof(uint32_t) + MAX_LIGHT_INDICES * sizeof(uint32_t);
+
+    // Light-cluster pairs left out of the lists since startup, counted as frames' results arrive
+    struct Stats {
+        // Out of index space, MAX_LIGHT_INDICES is too small for the scene
+        uint64_t overflowCount;
+        // Over the per-cluster cap of light_cluster.comp
+        uint64_t cappedCount;
+    };
+
+    // Reads the UBO and light buffer of the global set and writes its cluster buffer binding
+    LightClusterSystem(Device &device,
+                       PipelineRegistry &pipelineRegistry,
+                       VkDescriptorSetLayout globalSetLayout);
+    ~LightClusterSystem();
+
+    LightClusterSystem(const LightClusterSystem &) = delete;
+    LightClusterSystem &operator=(const LightClusterSystem &) = delete;
+
+    // Bound at global set binding 2
+    inline Buffer &getClusterBuffer(int frameIndex) { return *_clusterBuffers[frameIndex]; }
+
+    // Records the binning pass and the barrier that hands the lists to the fragment shaders. Must be recorded
+    // outside a render pass, after the frame's UBO and light buffer were written.
+    void buildClusters(FrameInfo &frameInfo, uint32_t lightCount);
+
+    inline const Stats &getStats() const { return _stats; }
+
+private:
+    void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+    void createPipeline(PipelineRegistry &pipelineRegistry);
+
+private:
+    Device &_device;
+
+    // Device-local, one per frame in flight
+    std::vector<std::unique_ptr<Buffer>> _clusterBuffers;
+    // Host-visible copies of each cluster buffer's header, read once the frame's fence was waited on
+    std::vector<std::unique_ptr<Buffer>> _headerBuffers;
+    Stats _stats{};
+
+    VkPipelineLayout _pipelineLayout;
+    std::unique_ptr<ComputePipeline> _pipeline;
+};
+}  // namespace vge
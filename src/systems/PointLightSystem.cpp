@@ -2,6 +2,7 @@
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <glm/glm.hpp>
@@ -10,111 +11,77 @@
 
 namespace vge {
 
-struct PointLightPushConstants {
-    glm::vec4 position{};
-    glm::vec4 color{};
-    float radius;
-};
-
 PointLightSystem::PointLightSystem(Device& device,
+                                   PipelineRegistry& pipelineRegistry,
                                    VkRenderPass renderPass,
-                                   VkDescriptorSetLayout globalSetLayout)
+                                   const RenderPassSignature& renderPassSignature,
+                                   VkDescriptorSetLayout globalSetLayout,
+                                   uint32_t subpass)
     : _device{device} {
-    createPipelineLayout(globalSetLayout);
-    createPipeline(renderPass);
+    createPipelineLayout(pipelineRegistry, globalSetLayout);
+    createPipeline(pipelineRegistry, renderPass, renderPassSignature, subpass);
 }
 
 PointLightSystem::~PointLightSystem() {
-    vkDestroyPipelineLayout(_device.getVkDevice(), _pipelineLayout, nullptr);
+    // The compile job may still be using the layout
+    _pipeline.wait();
 }
 
-void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PointLightPushConstants);
-
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-    if (vkCreatePipelineLayout(_device.getVkDevice(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
-    }
+void PointLightSystem::createPipelineLayout(PipelineRegistry& pipelineRegistry,
+                                            VkDescriptorSetLayout globalSetLayout) {
+    _pipelineLayout = pipelineRegistry.getPipelineLayoutCache().getLayout({globalSetLayout});
 }
 
-void PointLightSystem::createPipeline(VkRenderPass renderPass) {
+void PointLightSystem::createPipeline(PipelineRegistry& pipelineRegistry,
+                                      VkRenderPass renderPass,
+                                      const RenderPassSignature& renderPassSignature,
+                                      uint32_t subpass) {
     assert(_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-    PipelineConfigInfo pipelineConfig{};
+    PipelineDesc pipelineDesc{"../shaders/point_light.vert.spv", "../shaders/point_light.frag.spv"};
+    PipelineConfigInfo& pipelineConfig = pipelineDesc.configInfo;
     Pipeline::defaultPipelineConfigInfo(pipelineConfig);
     Pipeline::enableAlphaBlending(pipelineConfig);
+    // Billboards are generated in the shader facing the camera, no point in culling them
+    pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
 
     pipelineConfig.attributeDescriptions.clear();
     pipelineConfig.bindingDescriptions.clear();
 
     pipelineConfig.renderPass = renderPass;
+    pipelineConfig.renderPassSignature = renderPassSignature;
+    pipelineConfig.subpass = subpass;
     pipelineConfig.pipelineLayout = _pipelineLayout;
+    // Only the first subpass owns the depth attachment, later ones bind it read-only
+    if (subpass > 0) {
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    }
 
-    _pipeline = std::make_unique<Pipeline>(
-        _device, "../shaders/point_light.vert.spv", "../shaders/point_light.frag.spv", pipelineConfig);
+    _pipeline = pipelineRegistry.getPipeline(pipelineDesc);
 }
 
-void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo) {
-    auto rotateLight = glm::rotate(glm::mat4(1.0f), frameInfo.frameTime, {0.0f, -1.0f, 0.0f});
-
-    int lightIndex = 0;
-
-    for (auto& [index, obj] : frameInfo.gameObjects) {
-        if (!obj.pointLight) continue;
+void PointLightSystem::update(FrameInfo& frameInfo, Buffer& lightBuffer) {
+    const auto& lights = frameInfo.snapshot.pointLights;
+    _lightCount = static_cast<uint32_t>(std::min<size_t>(lights.size(), MAX_POINT_LIGHTS));
 
-        assert(lightIndex < MAX_LIGHTS);
-
-        ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.0f);
-        ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-
-        obj.transform.translation = glm::vec3(rotateLight * ubo.pointLights[lightIndex].position);
-
-        ++lightIndex;
+    // Written straight into the mapped buffer, no staging copy of the light list
+    auto lightData = static_cast<PointLightData*>(lightBuffer.getMappedMemory());
+    for (uint32_t i = 0; i < _lightCount; i++) {
+        const auto& light = lights[i];
+        lightData[i] = {glm::vec3(light.position), light.range, light.color, light.radius};
     }
-
-    ubo.numLights = lightIndex;
 }
 
 void PointLightSystem::render(FrameInfo& frameInfo) {
-    auto commandBuffer = frameInfo.commandBuffer;
-    _pipeline->bind(commandBuffer);
-
-    vkCmdBindDescriptorSets(commandBuffer,
-                            VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            _pipelineLayout,
-                            0,
-                            1,
-                            &frameInfo.globalDescriptorSet,
-                            0,
-                            nullptr);
-
-    for (auto& [index, obj] : frameInfo.gameObjects) {
-        if (!obj.pointLight) continue;
+    auto& recorder = frameInfo.recorder;
+    _pipeline.get()->bind(recorder);
 
-        // TODO: needs refactoring
-        PointLightPushConstants pushData{};
-        pushData.position = glm::vec4(obj.transform.translation, 1.0f);
-        pushData.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-        pushData.radius = obj.transform.scale.x;
+    recorder.bindDescriptorSets(
+        VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet);
 
-        vkCmdPushConstants(commandBuffer,
-                           _pipelineLayout,
-                           VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                           0,
-                           sizeof(PointLightPushConstants),
-                           &pushData);
-        vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+    // One billboard instance per light, the vertex shader fetches it from the light buffer
+    if (_lightCount > 0) {
+        recorder.draw(6, _lightCount, 0, 0);
     }
 }
 }  // namespace vge
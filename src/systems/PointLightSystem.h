@@ -3,32 +3,51 @@
 #include <memory>
 #include <vector>
 
+#include "Buffer.h"
 #include "Camera.h"
 #include "Device.h"
 #include "FrameInfo.h"
 #include "GameObject.h"
 #include "Pipeline.h"
+#include "PipelineRegistry.h"
 
 namespace vge {
 class PointLightSystem {
 public:
-    PointLightSystem(Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    // With the deferred path the billboards are drawn in the lighting subpass
+    PointLightSystem(Device &device,
+                     PipelineRegistry &pipelineRegistry,
+                     VkRenderPass renderPass,
+                     const RenderPassSignature &renderPassSignature,
+                     VkDescriptorSetLayout globalSetLayout,
+                     uint32_t subpass = 0);
     ~PointLightSystem();
 
     PointLightSystem(const PointLightSystem &) = delete;
     PointLightSystem &operator=(const PointLightSystem &) = delete;
 
-    void update(FrameInfo &frameInfo, GlobalUbo &ubo);
+    // Gathers the snapshot's lights into lightBuffer
+    void update(FrameInfo &frameInfo, Buffer &lightBuffer);
+    // Draws every light gathered by update as a billboard in a single instanced draw
     void render(FrameInfo &frameInfo);
 
+    // Lights gathered by the last update, all of them in the light buffer
+    inline uint32_t getLightCount() const { return _lightCount; }
+
 private:
-    void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-    void createPipeline(VkRenderPass renderPass);
+    void createPipelineLayout(PipelineRegistry &pipelineRegistry, VkDescriptorSetLayout globalSetLayout);
+    void createPipeline(PipelineRegistry &pipelineRegistry,
+                        VkRenderPass renderPass,
+                        const RenderPassSignature &renderPassSignature,
+                        uint32_t subpass);
 
 private:
     Device &_device;
 
-    std::unique_ptr<Pipeline> _pipeline;
+    // Compiled in the background, the first render call waits for it
+    PipelineCompiler::PipelineFuture _pipeline;
+    // Owned by the registry's pipeline layout cache
     VkPipelineLayout _pipelineLayout;
+    uint32_t _lightCount = 0;
 };
 }  // namespace vge
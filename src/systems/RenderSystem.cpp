@@ -1,88 +1,388 @@
 #include "RenderSystem.h"
 
+#include "SwapChain.h"
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstddef>
 #include <stdexcept>
 
 namespace vge {
 
-struct PushConstantData {
-    glm::mat4 modelMatrix{1.f};
-    glm::mat4 normalMatrix{1.f};
+// Smallest object buffer allocated, in objects
+static constexpr uint32_t MIN_OBJECT_CAPACITY = 64;
+// View depth mapped to the last depth bucket of the sort key, anything further shares it
+static constexpr float MAX_SORT_DEPTH = 256.0f;
+
+// Update data of the object set's template
+struct ObjectSetData {
+    VkDescriptorBufferInfo objects;
 };
 
-RenderSystem::RenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-    : _device{device} {
-    createPipelineLayout(globalSetLayout);
-    createPipeline(renderPass);
+RenderSystem::RenderSystem(Device& device,
+                           PipelineRegistry& pipelineRegistry,
+                           VkRenderPass renderPass,
+                           const RenderPassSignature& renderPassSignature,
+                           VkDescriptorSetLayout globalSetLayout,
+                           const ShadingOptions& shadingOptions,
+                           const MeshPool* meshPool,
+                           CullingMode cullingMode)
+    : _device{device}
+    , _meshPool{meshPool}
+    , _cullingMode{cullingMode}
+    , _objectBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT)
+    , _indirectBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT)
+    , _cullObjectBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT) {
+    // GPU culling compacts into indirect draw commands, so it needs the mesh pool. Occlusion culling splits
+    // the frame's render pass, which the deferred path's subpasses can't be.
+    if (_cullingMode == CullingMode::Occlusion && shadingOptions.deferred) {
+        _cullingMode = CullingMode::Gpu;
+    }
+    if (_cullingMode == CullingMode::Gpu || _cullingMode == CullingMode::Occlusion) {
+        if (_meshPool != nullptr) {
+            _cullingSystem = std::make_unique<CullingSystem>(
+                _device, pipelineRegistry, _cullingMode == CullingMode::Occlusion);
+        } else {
+            _cullingMode = CullingMode::Cpu;
+        }
+    }
+    if (_cullingMode == CullingMode::Software) {
+        _occlusionCuller = std::make_unique<OcclusionCuller>();
+    }
+    createObjectBuffers(pipelineRegistry);
+    createPipelineLayout(pipelineRegistry, globalSetLayout);
+    createPipeline(pipelineRegistry, renderPass, renderPassSignature, shadingOptions);
+}
+
+RenderSystem::~RenderSystem() {
+    // The compile job may still be using the layout
+    _pipeline.wait();
+    if (_depthPipeline.valid()) {
+        _depthPipeline.wait();
+    }
+}
+
+void RenderSystem::createObjectBuffers(PipelineRegistry& pipelineRegistry) {
+    _objectSetLayout = DescriptorSetLayout::Builder(_device)
+                           .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                           .build(pipelineRegistry.getLayoutCache());
+    _objectSetTemplate = DescriptorUpdateTemplate::Builder(_device, *_objectSetLayout)
+                             .addEntry(0, offsetof(ObjectSetData, objects))
+                             .build();
+
+    for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+        reserveObjects(i, MIN_OBJECT_CAPACITY);
+    }
 }
 
-RenderSystem::~RenderSystem() { vkDestroyPipelineLayout(_device.getVkDevice(), _pipelineLayout, nullptr); }
+void RenderSystem::reserveObjects(int frameIndex, uint32_t objectCount) {
+    auto& objectBuffer = _objectBuffers[frameIndex];
+    const uint32_t phaseCount = hasLatePass() ? 2 : 1;
+    if (objectBuffer != nullptr && objectBuffer->getInstanceCount() >= objectCount * phaseCount) {
+        return;
+    }
+
+    uint32_t capacity = MIN_OBJECT_CAPACITY;
+    while (capacity < objectCount) {
+        capacity *= 2;
+    }
+
+    constexpr VkMemoryPropertyFlags hostVisible =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
-void RenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PushConstantData);
+    // Only called for the frame being recorded, whose fence was waited on, so the old buffers are idle.
+    // With GPU culling the object buffer is written by the cull pass alone and can stay in device memory.
+    objectBuffer = std::make_unique<Buffer>(_device,
+                                            sizeof(ObjectData),
+                                            capacity * phaseCount,
+                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                            _cullingSystem != nullptr ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                                                      : hostVisible);
+    if (_cullingSystem == nullptr) {
+        objectBuffer->map();
+    }
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+    // There are never more batches than objects
+    if (_meshPool != nullptr) {
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        if (_cullingSystem != nullptr) {
+            usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        }
+        _indirectBuffers[frameIndex] = std::make_unique<Buffer>(
+            _device, sizeof(VkDrawIndexedIndirectCommand), capacity * phaseCount, usage, hostVisible);
+        _indirectBuffers[frameIndex]->map();
+    }
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-    if (vkCreatePipelineLayout(_device.getVkDevice(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
+    if (_cullingSystem != nullptr) {
+        _cullObjectBuffers[frameIndex] = std::make_unique<Buffer>(_device,
+                                                                  sizeof(CullingSystem::CullObject),
+                                                                  capacity,
+                                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                                  hostVisible);
+        _cullObjectBuffers[frameIndex]->map();
+        _cullingSystem->setBuffers(
+            frameIndex, *_cullObjectBuffers[frameIndex], *objectBuffer, *_indirectBuffers[frameIndex]);
     }
 }
 
-void RenderSystem::createPipeline(VkRenderPass renderPass) {
+void RenderSystem::createPipelineLayout(PipelineRegistry& pipelineRegistry,
+                                        VkDescriptorSetLayout globalSetLayout) {
+    _pipelineLayout = pipelineRegistry.getPipelineLayoutCache().getLayout(
+        {globalSetLayout, _objectSetLayout->getDescriptorSetLayout()});
+}
+
+void RenderSystem::createPipeline(PipelineRegistry& pipelineRegistry,
+                                  VkRenderPass renderPass,
+                                  const RenderPassSignature& renderPassSignature,
+                                  const ShadingOptions& shadingOptions) {
     assert(_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-    PipelineConfigInfo pipelineConfig{};
-    Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = _pipelineLayout;
-    _pipeline = std::make_unique<Pipeline>(
-        _device, "../shaders/shader.vert.spv", "../shaders/shader.frag.spv", pipelineConfig);
+    PipelineDesc pipelineDesc{"../shaders/shader.vert.spv", "../shaders/shader.frag.spv"};
+    Pipeline::defaultPipelineConfigInfo(pipelineDesc.configInfo);
+    pipelineDesc.configInfo.renderPass = renderPass;
+    pipelineDesc.configInfo.renderPassSignature = renderPassSignature;
+    pipelineDesc.configInfo.pipelineLayout = _pipelineLayout;
+
+    if (shadingOptions.deferred) {
+        pipelineDesc.fragFilepath = "../shaders/gbuffer.frag.spv";
+        pipelineDesc.configInfo.subpass = GBuffer::GEOMETRY_SUBPASS;
+        pipelineDesc.configInfo.colorAttachmentCount = GBuffer::GEOMETRY_COLOR_ATTACHMENT_COUNT;
+    }
+
+    Pipeline::setSpecializationConstant(
+        pipelineDesc.configInfo, SHADER_CONSTANT_SPECULAR_ENABLED, shadingOptions.specular ? VK_TRUE : VK_FALSE);
+    Pipeline::setSpecializationConstant(
+        pipelineDesc.configInfo, SHADER_CONSTANT_AMBIENT_ONLY, shadingOptions.ambientOnly ? VK_TRUE : VK_FALSE);
+
+    if (shadingOptions.depthPrePass) {
+        // Same layout and fixed-function state as the color pass so both rasterize identical depth
+        PipelineDesc depthDesc{"../shaders/depth_prepass.vert.spv", "", pipelineDesc.configInfo};
+        depthDesc.configInfo.specializationConstants.clear();
+        Pipeline::enableDepthOnly(depthDesc.configInfo);
+        _depthPipeline = pipelineRegistry.getPipeline(depthDesc);
+
+        Pipeline::enableDepthEqual(pipelineDesc.configInfo);
+    }
+    _pipeline = pipelineRegistry.getPipeline(pipelineDesc);
+}
+
+void RenderSystem::prepareGameObjects(FrameInfo& frameInfo) {
+    prepareInstances(frameInfo);
+
+    // Points at whichever object buffer the frame ended up with, no need to track when it was regrown
+    _objectDescriptorSet = frameInfo.descriptorAllocator.allocate(*_objectSetLayout);
+    const ObjectSetData objectSetData{_objectBuffers[frameInfo.frameIndex]->descriptorInfo()};
+    _objectSetTemplate->update(_objectDescriptorSet, &objectSetData);
+
+    if (_cullingSystem != nullptr) {
+        _cullingSystem->cull(frameInfo.recorder,
+                             frameInfo.frameIndex,
+                             frameInfo.camera,
+                             static_cast<uint32_t>(frameInfo.snapshot.objects.size()),
+                             frameInfo.extent);
+    }
+}
+
+void RenderSystem::beginOcclusionCulling(const FrameSnapshot& snapshot) {
+    if (_occlusionCuller != nullptr) {
+        _occlusionCuller->begin(snapshot.camera.getProjectionViewMatrix(), snapshot.objects);
+    }
+}
+
+void RenderSystem::finishOcclusionCulling() {
+    if (_occlusionCuller != nullptr) {
+        _occlusionCuller->finish();
+    }
+}
+
+void RenderSystem::cullOccludedGameObjects(FrameInfo& frameInfo, const DepthAttachment& depth) {
+    assert(hasLatePass() && "Occlusion culling is not enabled");
+    _cullingSystem->cullOccluded(frameInfo.recorder,
+                                 frameInfo.frameIndex,
+                                 frameInfo.camera,
+                                 static_cast<uint32_t>(frameInfo.snapshot.objects.size()),
+                                 static_cast<uint32_t>(_batches.size()),
+                                 depth);
 }
 
 void RenderSystem::renderGameObjects(FrameInfo& frameInfo) {
-    auto commandBuffer = frameInfo.commandBuffer;
-    _pipeline->bind(commandBuffer);
-
-    vkCmdBindDescriptorSets(commandBuffer,
-                            VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            _pipelineLayout,
-                            0,
-                            1,
-                            &frameInfo.globalDescriptorSet,
-                            0,
-                            nullptr);
-
-    for (const auto& [id, obj] : frameInfo.gameObjects) {
-
-        if (!obj.model) continue;
-
-        PushConstantData data{};
-        data.modelMatrix = obj.transform.mat4();
-        data.normalMatrix = obj.transform.normalMatrix();
-
-        vkCmdPushConstants(commandBuffer,
-                           _pipelineLayout,
-                           VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                           0,
-                           sizeof(PushConstantData),
-                           &data);
-        obj.model->bind(commandBuffer);
-        obj.model->draw(commandBuffer);
+    _frameStats = {};
+    _frameStats.sortTime = _renderQueue.getSortTime();
+    if (_occlusionCuller != nullptr) {
+        _frameStats.occludedCount = _occludedCount;
+        _frameStats.occlusionRasterTime = _occlusionCuller->getStats().rasterTime;
+        _frameStats.occlusionTestTime = _occlusionCuller->getStats().testTime;
+    }
+    if (_batches.empty()) {
+        return;
+    }
+
+    recordDraws(frameInfo, 0);
+}
+
+void RenderSystem::renderLateGameObjects(FrameInfo& frameInfo) {
+    assert(hasLatePass() && "Occlusion culling is not enabled");
+    if (_batches.empty()) {
+        return;
+    }
+
+    // The second phase's commands follow the first's
+    recordDraws(frameInfo, static_cast<uint32_t>(_batches.size()));
+}
+
+void RenderSystem::recordDraws(FrameInfo& frameInfo, uint32_t firstDraw) {
+    auto& recorder = frameInfo.recorder;
+
+    // Both passes share the pipeline layout, so the sets stay bound across the pipeline switch
+    VkDescriptorSet descriptorSets[] = {frameInfo.globalDescriptorSet, _objectDescriptorSet};
+    recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 2, descriptorSets);
+    ++_frameStats.descriptorSetBinds;
+
+    if (_depthPipeline.valid()) {
+        _depthPipeline.get()->bind(recorder);
+        ++_frameStats.pipelineBinds;
+        drawBatches(frameInfo, true, firstDraw);
+    }
+
+    _pipeline.get()->bind(recorder);
+    ++_frameStats.pipelineBinds;
+    drawBatches(frameInfo, false, firstDraw);
+}
+
+uint32_t RenderSystem::getMeshId(const Model* model) {
+    // Assigned on first sight and kept, so the order between meshes is the same every frame
+    auto meshId = _meshIds.try_emplace(model, static_cast<uint32_t>(_meshIds.size()));
+    return meshId.first->second;
+}
+
+void RenderSystem::prepareInstances(FrameInfo& frameInfo) {
+    const auto& objects = frameInfo.snapshot.objects;
+
+    const bool cpuCulling = _cullingMode == CullingMode::Cpu || _cullingMode == CullingMode::Software;
+    if (cpuCulling) {
+        _frustumCuller.clear();
+        _frustumCuller.reserve(objects.size());
+        for (const auto& obj : objects) {
+            _frustumCuller.add(obj.model->getBoundingBox(), obj.modelMatrix);
+        }
+        _frustumCuller.cull(frameInfo.camera.getFrustumPlanes(), _visibility);
+    }
+
+    // Only counts the objects the frustum left, the occlusion test passes everything off screen
+    _occludedCount = 0;
+    if (_occlusionCuller != nullptr && _occlusionCuller->finish()) {
+        const auto& occlusionVisibility = _occlusionCuller->getVisibility();
+        for (size_t i = 0; i < _visibility.size(); i++) {
+            if (_visibility[i] && !occlusionVisibility[i]) {
+                _visibility[i] = 0;
+                ++_occludedCount;
+            }
+        }
+    }
+
+    // A single opaque pass, pipeline and material so far: draws group by mesh, front to back within one
+    const glm::mat4& view = frameInfo.camera.getViewMatrix();
+    _renderQueue.clear();
+    for (uint32_t i = 0; i < static_cast<uint32_t>(objects.size()); i++) {
+        if (cpuCulling && !_visibility[i]) {
+            continue;
+        }
+
+        const float viewDepth = (view * objects[i].modelMatrix[3]).z;
+        const uint32_t meshId = getMeshId(objects[i].model);
+        _renderQueue.push(RenderQueue::makeKey(0, 0, 0, meshId, viewDepth / MAX_SORT_DEPTH), i);
+    }
+    _renderQueue.sort();
+
+    const auto& items = _renderQueue.getItems();
+    const auto drawCount = static_cast<uint32_t>(items.size());
+    reserveObjects(frameInfo.frameIndex, drawCount);
+
+    _batches.clear();
+    for (uint32_t i = 0; i < drawCount; i++) {
+        const auto& obj = objects[items[i].index];
+
+        if (_batches.empty() || _batches.back().model != obj.model) {
+            _batches.push_back({obj.model, i, 0});
+        }
+        ++_batches.back().instanceCount;
+
+        if (_cullingSystem != nullptr) {
+            const auto& boundingSphere = obj.model->getBoundingSphere();
+
+            CullingSystem::CullObject cullObject{};
+            cullObject.modelMatrix = obj.modelMatrix;
+            cullObject.normalMatrix = obj.normalMatrix;
+            cullObject.boundingSphere = glm::vec4(boundingSphere.center, boundingSphere.radius);
+            cullObject.drawIndex = static_cast<uint32_t>(_batches.size() - 1);
+            cullObject.objectId = items[i].index;
+            _cullObjectBuffers[frameInfo.frameIndex]->writeToIndex(&cullObject, static_cast<int>(i));
+        } else {
+            ObjectData data{};
+            data.modelMatrix = obj.modelMatrix;
+            data.normalMatrix = obj.normalMatrix;
+            _objectBuffers[frameInfo.frameIndex]->writeToIndex(&data, static_cast<int>(i));
+        }
+    }
+
+    if (_meshPool == nullptr) {
+        return;
+    }
+
+    auto& indirectBuffer = *_indirectBuffers[frameInfo.frameIndex];
+    for (size_t i = 0; i < _batches.size(); i++) {
+        const auto& range = _meshPool->getRange(_batches[i].model);
+
+        VkDrawIndexedIndirectCommand command{};
+        command.indexCount = range.indexCount;
+        // The cull pass counts the visible instances up from zero
+        command.instanceCount = _cullingSystem != nullptr ? 0 : _batches[i].instanceCount;
+        command.firstIndex = range.firstIndex;
+        command.vertexOffset = range.vertexOffset;
+        command.firstInstance = _batches[i].firstInstance;
+        indirectBuffer.writeToIndex(&command, static_cast<int>(i));
+
+        // The second phase appends to its own commands, whose instances start past every first phase one
+        if (hasLatePass()) {
+            command.firstInstance += _cullObjectBuffers[frameInfo.frameIndex]->getInstanceCount();
+            indirectBuffer.writeToIndex(&command, static_cast<int>(_batches.size() + i));
+        }
+    }
+}
+
+void RenderSystem::drawBatches(FrameInfo& frameInfo, bool positionsOnly, uint32_t firstDraw) {
+    auto& recorder = frameInfo.recorder;
+
+    // Recording cost no longer depends on the number of objects or meshes
+    if (_meshPool != nullptr) {
+        _meshPool->bind(recorder, positionsOnly);
+        ++_frameStats.vertexBufferBinds;
+        ++_frameStats.indexBufferBinds;
+        ++_frameStats.draws;
+        recorder.drawIndexedIndirect(_indirectBuffers[frameInfo.frameIndex]->getBuffer(),
+                                     firstDraw * sizeof(VkDrawIndexedIndirectCommand),
+                                     static_cast<uint32_t>(_batches.size()),
+                                     sizeof(VkDrawIndexedIndirectCommand));
+        return;
+    }
+
+    // Batches are sorted by mesh, so every model is bound once per pass
+    for (const auto& batch : _batches) {
+        if (positionsOnly) {
+            batch.model->bindPositions(recorder);
+        } else {
+            batch.model->bind(recorder);
+        }
+        ++_frameStats.vertexBufferBinds;
+        ++_frameStats.indexBufferBinds;
+        ++_frameStats.draws;
+        batch.model->draw(recorder, batch.instanceCount, batch.firstInstance);
     }
 }
 }  // namespace vge
@@ -1,33 +1,171 @@
 #pragma once
 
+#include "Buffer.h"
 #include "Camera.h"
+#include "CullingSystem.h"
+#include "Descriptor.h"
+#include "FrustumCuller.h"
+#include "GBuffer.h"
 #include "Device.h"
 #include "GameObject.h"
+#include "MeshPool.h"
+#include "OcclusionCuller.h"
 #include "Pipeline.h"
+#include "PipelineRegistry.h"
+#include "RenderQueue.h"
 #include "FrameInfo.h"
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace vge {
 class RenderSystem {
 public:
-    RenderSystem(Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    // Each combination is its own set of pipeline permutations
+    struct ShadingOptions {
+        // Baked into the pipeline through specialization constants
+        bool specular;
+        bool ambientOnly;
+        // Lay down depth with a position-only pass first, then shade only the visible fragments
+        bool depthPrePass;
+        // Write albedo and normals to the G-buffer instead of shading, DeferredLightingSystem lights them.
+        // Needs a render pass of the deferred shading path.
+        bool deferred;
+    };
+
+    enum class CullingMode {
+        None,
+        // Frustum culls the objects' bounding boxes with SIMD before batching
+        Cpu,
+        // Cpu plus occlusion culling against the occluder objects rasterized on worker threads, see
+        // OcclusionCuller. Started by beginOcclusionCulling ahead of the frame.
+        Software,
+        // Frustum culls in a compute pass that fills the indirect draws. Needs a mesh pool, otherwise
+        // falls back to Cpu.
+        Gpu,
+        // Gpu plus two-phase occlusion culling against a depth pyramid, see CullingSystem. The frame is drawn
+        // in two render passes. Needs the forward shading path, otherwise falls back to Gpu.
+        Occlusion,
+    };
+
+    // One entry of the per-frame object storage buffer, fetched in the vertex shader with gl_InstanceIndex
+    struct ObjectData {
+        glm::mat4 modelMatrix{1.0f};
+        glm::mat4 normalMatrix{1.0f};
+    };
+
+    RenderSystem(Device &device,
+                 PipelineRegistry &pipelineRegistry,
+                 VkRenderPass renderPass,
+                 const RenderPassSignature &renderPassSignature,
+                 VkDescriptorSetLayout globalSetLayout,
+                 const ShadingOptions &shadingOptions,
+                 const MeshPool *meshPool = nullptr,
+                 CullingMode cullingMode = CullingMode::None);
     ~RenderSystem();
 
     RenderSystem(const RenderSystem &) = delete;
     RenderSystem &operator=(const RenderSystem &) = delete;
 
+    // Uploads the frame's object data and, with GPU culling, records the cull pass. Must be called before
+    // the render pass begins.
+    void prepareGameObjects(FrameInfo& frameInfo);
+    // With a mesh pool the whole scene is one indirect draw per pass, otherwise one draw per model. With
+    // occlusion culling only the objects the first phase found.
     void renderGameObjects(FrameInfo& frameInfo);
 
+    // Occlusion culling draws the frame in two render passes, with cullOccludedGameObjects recorded between
+    // them and renderLateGameObjects in the second
+    inline bool hasLatePass() const { return _cullingMode == CullingMode::Occlusion; }
+    // Culls against the depth renderGameObjects left behind. Must be recorded outside a render pass.
+    void cullOccludedGameObjects(FrameInfo& frameInfo, const DepthAttachment& depth);
+    // Draws the objects that only the second culling phase found visible
+    void renderLateGameObjects(FrameInfo& frameInfo);
+
+    // Software occlusion culling only: starts culling the snapshot on worker threads, prepareGameObjects
+    // waits for the result. The snapshot must stay unchanged until then, or until finishOcclusionCulling if
+    // the frame is not rendered after all.
+    void beginOcclusionCulling(const FrameSnapshot& snapshot);
+    void finishOcclusionCulling();
+
+    // Null unless culling on the GPU
+    inline const CullingSystem* getCullingSystem() const { return _cullingSystem.get(); }
+    // Null unless culling in software
+    inline const OcclusionCuller* getOcclusionCuller() const { return _occlusionCuller.get(); }
+
+    // Work done by the last renderGameObjects call
+    struct FrameStats {
+        float sortTime;
+        uint32_t pipelineBinds;
+        uint32_t descriptorSetBinds;
+        uint32_t vertexBufferBinds;
+        uint32_t indexBufferBinds;
+        uint32_t draws;
+        // Software occlusion culling only: objects in the frustum but hidden, and the cull's times
+        uint32_t occludedCount;
+        float occlusionRasterTime;
+        float occlusionTestTime;
+    };
+
+    inline const FrameStats& getFrameStats() const { return _frameStats; }
+
 private:
-    void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-    void createPipeline(VkRenderPass renderPass);
+    void createObjectBuffers(PipelineRegistry &pipelineRegistry);
+    void createPipelineLayout(PipelineRegistry &pipelineRegistry, VkDescriptorSetLayout globalSetLayout);
+    void createPipeline(PipelineRegistry &pipelineRegistry,
+                        VkRenderPass renderPass,
+                        const RenderPassSignature &renderPassSignature,
+                        const ShadingOptions &shadingOptions);
+    // Groups the snapshot's objects by model and writes their object data and draw commands for this frame
+    void prepareInstances(FrameInfo &frameInfo);
+    void reserveObjects(int frameIndex, uint32_t objectCount);
+    void recordDraws(FrameInfo &frameInfo, uint32_t firstDraw);
+    // firstDraw selects the culling phase's draw commands when drawing indirect
+    void drawBatches(FrameInfo &frameInfo, bool positionsOnly, uint32_t firstDraw);
+    uint32_t getMeshId(const Model *model);
 
 private:
     Device& _device;
+    // Null unless rendering GPU-driven
+    const MeshPool* _meshPool;
+    CullingMode _cullingMode;
 
-    std::unique_ptr<Pipeline> _pipeline;
+    // Compiled in the background, the first render call waits for it
+    PipelineCompiler::PipelineFuture _pipeline;
+    // Only valid when the depth pre-pass is enabled
+    PipelineCompiler::PipelineFuture _depthPipeline;
+    // Owned by the registry's pipeline layout cache
     VkPipelineLayout _pipelineLayout;
+
+    // All objects sharing a model, drawn with a single instanced draw
+    struct Batch {
+        Model* model;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // Set 1: the object storage buffer. One host-visible buffer per frame in flight, grown on demand.
+    std::shared_ptr<DescriptorSetLayout> _objectSetLayout;
+    // Allocated from the frame's descriptor allocator every frame and written in one templated update
+    VkDescriptorSet _objectDescriptorSet = VK_NULL_HANDLE;
+    std::unique_ptr<DescriptorUpdateTemplate> _objectSetTemplate;
+    std::vector<std::unique_ptr<Buffer>> _objectBuffers;
+    // GPU-driven only: one VkDrawIndexedIndirectCommand per batch, and another per batch for the second
+    // phase of occlusion culling. The object buffer likewise keeps the second phase's instances in a second
+    // half.
+    std::vector<std::unique_ptr<Buffer>> _indirectBuffers;
+    // GPU culling only: the cull pass input, from which visible objects are compacted into _objectBuffers
+    std::vector<std::unique_ptr<Buffer>> _cullObjectBuffers;
+    std::unique_ptr<CullingSystem> _cullingSystem;
+
+    std::vector<Batch> _batches;
+    RenderQueue _renderQueue;
+    std::unordered_map<const Model*, uint32_t> _meshIds;
+    FrameStats _frameStats{};
+    FrustumCuller _frustumCuller;
+    std::vector<uint8_t> _visibility;
+    std::unique_ptr<OcclusionCuller> _occlusionCuller;
+    uint32_t _occludedCount = 0;
 };
 }  // namespace vge